@@ -7,19 +7,52 @@
 #include "ns3/network-module.h"
 #include "ns3/ipv4-flow-classifier.h"
 #include "ns3/big-brother-flow-probe.h"
+#include "ns3/flow-anomaly-detector.h"
 #include "ns3/ipv4-flow-probe.h"
+#include "ns3/ipv6-flow-classifier.h"
+#include "ns3/ipv4-link-tomography.h"
+#include "ns3/measurement-scheduler.h"
+#include "ns3/nr-flow-probe.h"
+#include "ns3/tcp-rtt-flow-probe.h"
 #include <tinyxml2.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <regex>
+#include <set>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
 using namespace tinyxml2;
 
 using namespace ns3;
 
-ns3::Time NETWORK_OK_MEASURING_TIME = MilliSeconds(1000);
-ns3::Time NETWORK_NOT_OK_MEASURING_TIME = MilliSeconds(500);
-ns3::Time NEXT_MEASURE_IN = MilliSeconds(1000);
-
-float RELATIVE_THRESHOLD_THROUGHPUT_ACCEPTANCE = 0.5;
-float RELATIVE_THRESHOLD_DELAY_ACCEPTANCE = 0.1;
-float RELATIVE_THRESHOLD_JITTER_ACCEPTANCE = 0.1;
+// Number of links ranked as the worst at every node-to-node trigger
+uint32_t WORST_LINKS_K = 3;
+// Consecutive triggers a link must spend in (out of) the worst K before its incident starts (ends)
+uint32_t WORST_LINK_HYSTERESIS = 3;
+// CUSUM of every link delay: increase over the baseline that is tolerated, relative to the baseline
+double CUSUM_RELATIVE_DRIFT = 0.1;
+// Floor of the tolerated increase, for the links whose baseline is close to 0
+ns3::Time CUSUM_MIN_DRIFT = MicroSeconds(10);
+// The CUSUM alarms when it goes over this many times the tolerated increase
+double CUSUM_ALARM_DRIFTS = 5;
+// Weight of a new measurement in the baseline of a link
+double CUSUM_BASELINE_WEIGHT = 0.1;
 
 struct TrackedStats {
     float rxDuration; // Double but it stores seconds!S
@@ -47,8 +80,248 @@ struct TrackedStats {
           delayValuesMedian(delayValuesMedian) {}
 };
 
-bool compareByTime(const std::pair<uint32_t, ns3::Time>& a, const std::pair<uint32_t, ns3::Time>& b) {
-    return a.second.Compare(b.second) < 0;
+// One probe's sighting of a packet: the columns joined to rebuild the packet paths
+struct PacketHop {
+    uint32_t packetId;
+    uint32_t nodeId;
+    int64_t delay; // Delay from the first probe, in nanoseconds
+};
+
+// Sorts the hops by packetId, then by delay, with an LSD radix sort on bytes.
+// Passes where every hop has the same byte are skipped, so the high bytes of
+// the delays and of the packet ids usually cost a single counting pass
+void radixSortPacketHops(std::vector<PacketHop>& hops, std::vector<PacketHop>& scratch) {
+    // Bytes 0-7 are the delay, 8-11 the packetId: the least significant key first
+    auto digit = [](const PacketHop& hop, uint32_t byte) -> uint32_t {
+        if (byte < 8) {
+            return (static_cast<uint64_t>(hop.delay) >> (8 * byte)) & 0xff;
+        }
+        return (hop.packetId >> (8 * (byte - 8))) & 0xff;
+    };
+    std::vector<std::array<uint32_t, 256>> counts(12);
+    for (std::array<uint32_t, 256>& count : counts) {
+        count.fill(0);
+    }
+    for (const PacketHop& hop : hops) {
+        for (uint32_t byte = 0; byte < 12; ++byte) {
+            ++counts[byte][digit(hop, byte)];
+        }
+    }
+    scratch.resize(hops.size());
+    for (uint32_t byte = 0; byte < 12; ++byte) {
+        std::array<uint32_t, 256>& count = counts[byte];
+        if (hops.empty() || count[digit(hops.front(), byte)] == hops.size()) {
+            continue;
+        }
+        uint32_t offset = 0;
+        for (uint32_t& bucket : count) {
+            uint32_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (const PacketHop& hop : hops) {
+            scratch[count[digit(hop, byte)]++] = hop;
+        }
+        hops.swap(scratch);
+    }
+}
+
+// 0.975 quantile of the Student t distribution, for 95% two-sided intervals
+double tQuantile975(uint32_t degreesOfFreedom) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if (degreesOfFreedom == 0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    if (degreesOfFreedom <= 30) {
+        return table[degreesOfFreedom - 1];
+    }
+    return 1.960 + 2.4 / degreesOfFreedom;
+}
+
+// Delay of a link over every packet of every flow that crossed it, accumulated in a
+// single pass (Welford). Each packet is one sample, so the mean is weighted by the
+// number of packets each flow sent over the link
+struct LinkDelayStats {
+    uint32_t samples = 0;
+    double mean = 0; // In nanoseconds
+    double m2 = 0; // Sum of the squared deviations from the mean
+    void add(double delay) {
+        ++samples;
+        double deviation = delay - mean;
+        mean += deviation / samples;
+        m2 += deviation * (delay - mean);
+    }
+    // Sample variance, in ns^2
+    double variance() const {
+        return samples > 1 ? m2 / (samples - 1) : 0;
+    }
+    // Half width of the 95% confidence interval of the mean, in ns. Infinite with a single sample
+    double ci95HalfWidth() const {
+        return tQuantile975(samples - 1) * std::sqrt(variance() / samples);
+    }
+    // Adds the samples of other stats (Chan et al.)
+    void merge(const LinkDelayStats& other) {
+        if (other.samples == 0) {
+            return;
+        }
+        uint32_t total = samples + other.samples;
+        double deviation = other.mean - mean;
+        mean += deviation * other.samples / total;
+        m2 += other.m2 + deviation * deviation * samples * other.samples / total;
+        samples = total;
+    }
+};
+// (from node, to node) -> delay of the link in that direction
+typedef std::map<std::pair<uint32_t,uint32_t>,LinkDelayStats> LinkDelays;
+
+// Whether the mean delay of a is above b's with at least 95% confidence (one-sided
+// Welch t-test). Stats with a single sample are never significantly worse
+bool significantlyWorse(const LinkDelayStats& a, const LinkDelayStats& b) {
+    if (a.samples < 2 || b.samples < 2) {
+        return false;
+    }
+    double va = a.variance() / a.samples;
+    double vb = b.variance() / b.samples;
+    double difference = a.mean - b.mean;
+    if (va + vb == 0) {
+        return difference > 0;
+    }
+    // Welch-Satterthwaite degrees of freedom. Comparing with the 0.975 quantile makes
+    // the one-sided test conservative: it holds at the 97.5% level
+    double degreesOfFreedom = (va + vb) * (va + vb) /
+        (va * va / (a.samples - 1) + vb * vb / (b.samples - 1));
+    return difference / std::sqrt(va + vb) > tQuantile975(static_cast<uint32_t>(degreesOfFreedom));
+}
+// (from node, to node) -> sightings of packets by the two probed nodes one after the
+// other, while the nodes are not adjacent: a probe between them missed the packet, so
+// the delay is not attributed to any link
+typedef std::map<std::pair<uint32_t,uint32_t>,uint64_t> UnattributedHops;
+
+// Directed links between the nodes, packed as (from << 32) | to
+typedef std::unordered_set<uint64_t> NodeAdjacency;
+// Links of the simulation: the channels of the nodes' devices are added by the first
+// trigger, and scenarios add the links without an ns-3 channel, e.g. the NR UE to gNB
+// attachments, with addNodeAdjacency() before it
+NodeAdjacency NODE_ADJACENCY;
+bool NODE_ADJACENCY_HAS_CHANNELS = false;
+
+uint64_t packNodePair(uint32_t from, uint32_t to) {
+    return (static_cast<uint64_t>(from) << 32) | to;
+}
+
+// Adds a link between two nodes, in both directions
+void addNodeAdjacency(uint32_t nodeId1, uint32_t nodeId2) {
+    NODE_ADJACENCY.insert(packNodePair(nodeId1, nodeId2));
+    NODE_ADJACENCY.insert(packNodePair(nodeId2, nodeId1));
+}
+
+// Adds the links of every channel (point-to-point, CSMA, the EPC links) between the
+// nodes of its devices, once. Must run on the simulation thread, before the analysis
+void addChannelAdjacency() {
+    if (NODE_ADJACENCY_HAS_CHANNELS) {
+        return;
+    }
+    NODE_ADJACENCY_HAS_CHANNELS = true;
+    std::set<Ptr<Channel>> channels;
+    for (auto node = NodeList::Begin(); node != NodeList::End(); ++node) {
+        for (uint32_t i = 0; i < (*node)->GetNDevices(); ++i) {
+            Ptr<Channel> channel = (*node)->GetDevice(i)->GetChannel();
+            if (!channel || !channels.insert(channel).second) {
+                continue;
+            }
+            for (std::size_t a = 0; a < channel->GetNDevices(); ++a) {
+                for (std::size_t b = a + 1; b < channel->GetNDevices(); ++b) {
+                    addNodeAdjacency(channel->GetDevice(a)->GetNode()->GetId(), channel->GetDevice(b)->GetNode()->GetId());
+                }
+            }
+        }
+    }
+}
+
+// Nodes whose probes record the hops of the packets, sorted
+std::vector<uint32_t> findHopProbedNodes(Ptr<FlowMonitor> monitor) {
+    std::set<uint32_t> nodes;
+    for (Ptr<FlowProbe> probe : monitor->GetAllProbes()) {
+        BigBrotherHopStore* hopStore = BigBrotherHopStore::Get(probe);
+        if (hopStore && (hopStore->GetFeatures() & bigbrother::PerHop::mask)) {
+            nodes.insert(hopStore->m_nodeId);
+        }
+    }
+    return std::vector<uint32_t>(nodes.begin(), nodes.end());
+}
+
+// Links between the probed nodes, by set of probed nodes
+std::map<std::vector<uint32_t>,NodeAdjacency> PROBED_ADJACENCIES;
+
+// Links between the nodes of the monitor's probes that record hops. The probes may
+// skip nodes, e.g. the gNBs and the SGW of topology_1_3: a path of the simulation's
+// links through nodes without probes is a single virtual link between the probed
+// nodes at its ends. Found once per set of probed nodes, by a breadth-first search
+// from every probed node that stops at the probed nodes. Must run on the simulation
+// thread
+const NodeAdjacency& getProbedAdjacency(Ptr<FlowMonitor> monitor) {
+    addChannelAdjacency();
+    std::vector<uint32_t> probedNodes = findHopProbedNodes(monitor);
+    auto insert = PROBED_ADJACENCIES.try_emplace(probedNodes);
+    NodeAdjacency& adjacency = insert.first->second;
+    if (!insert.second) {
+        return adjacency;
+    }
+    std::unordered_map<uint32_t,std::vector<uint32_t>> neighbours;
+    for (uint64_t link : NODE_ADJACENCY) {
+        neighbours[static_cast<uint32_t>(link >> 32)].push_back(static_cast<uint32_t>(link));
+    }
+    std::unordered_set<uint32_t> probed(probedNodes.begin(), probedNodes.end());
+    for (uint32_t source : probedNodes) {
+        std::unordered_set<uint32_t> visited{source};
+        std::deque<uint32_t> queue{source};
+        while (!queue.empty()) {
+            uint32_t node = queue.front();
+            queue.pop_front();
+            for (uint32_t next : neighbours[node]) {
+                if (!visited.insert(next).second) {
+                    continue;
+                }
+                if (probed.count(next)) {
+                    adjacency.insert(packNodePair(source, next));
+                } else {
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+    return adjacency;
+}
+
+// Adds the delay between consecutive probes of every packet to the stats of the
+// directed link between them. The hops must be sorted by packetId and delay. Hops
+// of a packet with the same delay are reordered to follow the links, and consecutive
+// hops whose nodes are not adjacent are counted in unattributed instead. Two probes of
+// the same node (IPv4 and NR) seeing the packet one after the other make no link
+void joinPacketHops(std::vector<PacketHop>& hops, const NodeAdjacency& adjacency, LinkDelays& linkDelays, UnattributedHops& unattributed) {
+    for (size_t i = 1; i < hops.size(); ++i) {
+        const PacketHop& previous = hops[i - 1];
+        if (previous.packetId != hops[i].packetId || previous.nodeId == hops[i].nodeId) {
+            continue;
+        }
+        if (!adjacency.count(packNodePair(previous.nodeId, hops[i].nodeId))) {
+            for (size_t j = i + 1; j < hops.size() && hops[j].packetId == previous.packetId && hops[j].delay == hops[i].delay; ++j) {
+                if (adjacency.count(packNodePair(previous.nodeId, hops[j].nodeId))) {
+                    std::swap(hops[i], hops[j]);
+                    break;
+                }
+            }
+        }
+        const PacketHop& current = hops[i];
+        std::pair<uint32_t,uint32_t> nodePair(previous.nodeId, current.nodeId);
+        if (adjacency.count(packNodePair(previous.nodeId, current.nodeId))) {
+            linkDelays[nodePair].add(current.delay - previous.delay);
+        } else {
+            ++unattributed[nodePair];
+        }
+    }
 }
 
 bool IsFlowStatsEmpty(const FlowId flowId, const FlowMonitor::FlowStats& flowStat)
@@ -65,6 +338,77 @@ bool IsFlowStatsEmpty(const FlowId flowId, const FlowMonitor::FlowStats& flowSta
         flowStat.packetsDropped.empty());
 }
 
+// The TcpRttFlowProbes of a monitor
+std::vector<Ptr<TcpRttFlowProbe>> findRttProbes(Ptr<FlowMonitor> monitor)
+{
+    std::vector<Ptr<TcpRttFlowProbe>> rttProbes;
+    for (Ptr<FlowProbe> probe : monitor->GetAllProbes()) {
+        Ptr<TcpRttFlowProbe> rttProbe = DynamicCast<TcpRttFlowProbe>(probe);
+        if (rttProbe) {
+            rttProbes.push_back(rttProbe);
+        }
+    }
+    return rttProbes;
+}
+
+// The IPv6 classifier of a monitor, nullptr if it only classifies IPv4
+Ptr<Ipv6FlowClassifier> findIpv6Classifier(Ptr<FlowMonitor> monitor)
+{
+    for (const Ptr<FlowClassifier>& classifier : monitor->GetFlowClassifiers()) {
+        Ptr<Ipv6FlowClassifier> classifier6 = DynamicCast<Ipv6FlowClassifier>(classifier);
+        if (classifier6) {
+            return classifier6;
+        }
+    }
+    return nullptr;
+}
+
+// The NrFlowProbes of a monitor
+std::vector<Ptr<NrFlowProbe>> findNrProbes(Ptr<FlowMonitor> monitor)
+{
+    std::vector<Ptr<NrFlowProbe>> nrProbes;
+    for (Ptr<FlowProbe> probe : monitor->GetAllProbes()) {
+        Ptr<NrFlowProbe> nrProbe = DynamicCast<NrFlowProbe>(probe);
+        if (nrProbe) {
+            nrProbes.push_back(nrProbe);
+        }
+    }
+    return nrProbes;
+}
+
+// RTT of a TCP conversation, keyed on its data flow, read in place. Every TcpRttFlowProbe
+// measures from its own node, so we keep the longest one: the probe closest to the sender.
+// nullptr if no probe has samples of the flow
+const TcpRttFlowProbe::RttStats* findRttStats(const std::vector<Ptr<TcpRttFlowProbe>>& rttProbes, FlowId flowId)
+{
+    const TcpRttFlowProbe::RttStats* longest = nullptr;
+    for (const Ptr<TcpRttFlowProbe>& rttProbe : rttProbes) {
+        const std::map<FlowId, TcpRttFlowProbe::RttStats>& probeStats = rttProbe->GetRttStats();
+        auto stats = probeStats.find(flowId);
+        if (stats == probeStats.end() || stats->second.samples == 0) {
+            continue;
+        }
+        if (!longest || stats->second.rttSum / stats->second.samples > longest->rttSum / longest->samples) {
+            longest = &stats->second;
+        }
+    }
+    return longest;
+}
+
+// Value below which a fraction q of the histogram samples fall, at bin resolution
+double histogramPercentile(const Histogram& histogram, uint32_t samples, double q)
+{
+    uint64_t target = std::ceil(q * samples);
+    uint64_t count = 0;
+    for (uint32_t bin = 0; bin < histogram.GetNBins(); bin++) {
+        count += histogram.GetBinCount(bin);
+        if (count >= target) {
+            return histogram.GetBinStart(bin) + histogram.GetBinWidth(bin);
+        }
+    }
+    return 0;
+}
+
 void ChangeLinkDelay(Ptr<NetDevice> device, std::string newDelay) {
     std::cout << Simulator::Now().As(Time::MS) <<" Changing link delay!" << std::endl;
     Ptr<PointToPointChannel> p2pChannel = device->GetChannel()->GetObject<PointToPointChannel>();
@@ -75,425 +419,1265 @@ void ChangeLinkDelay(Ptr<NetDevice> device, std::string newDelay) {
     }
 }
 
+// Node-to-node measurements of a _node_to_node_delays.xml document. Every trigger
+// appends its measurements to <document>.log and keeps them in memory, and
+// finalizeNodeToNodeDoc() writes the XML once, when the simulation is destroyed,
+// so the I/O of a trigger does not grow with the measurements taken so far.
+struct NodeToNodeMeasurement {
+    int64_t delayValue; // Mean delay of the link, in ns
+    int64_t timestamp; // In ns
+    uint32_t samples; // Packets the mean is computed from
+    int64_t ci95; // Half width of the 95% confidence interval of the mean, in ns, -1 if unknown
+};
+// A link that stayed among the worst ("worst"), or whose delay shifted up ("change")
+struct LinkIncident {
+    std::string kind;
+    std::pair<uint32_t,uint32_t> nodePair;
+    int64_t start; // In ns
+    int64_t end; // In ns, -1 while the incident is open
+    int64_t peakDelay; // Highest mean delay measured during the incident, in ns
+};
+struct NodeToNodeSeries {
+    std::pair<uint32_t,uint32_t> nodePair;
+    std::vector<NodeToNodeMeasurement> measurements;
+    // Hysteresis of the worst K ranking: consecutive triggers in and out of it,
+    // the first of the current run in it, and the last trigger it was ranked at
+    uint32_t triggersInTopK = 0;
+    uint32_t triggersOutOfTopK = 0;
+    int64_t inTopKSince = -1;
+    int64_t lastInTopK = -1;
+    // One-sided CUSUM of the delay over its baseline, and when it last left 0
+    double baseline = 0;
+    double cusum = 0;
+    int64_t cusumSince = -1;
+    // Open incidents of the link, as indexes in NodeToNodeDoc::incidents, -1 if none
+    int64_t worstIncident = -1;
+    int64_t changeIncident = -1;
+};
+struct NodeToNodeDoc {
+    std::ofstream log;
+    // Series of every node pair, in the order they were first measured
+    std::vector<NodeToNodeSeries> series;
+    // (node, node), packed in 64 bits -> index in series, so recording is an O(1) append
+    std::unordered_map<uint64_t,size_t> seriesIndex;
+    // Incidents of all the links, in the order they started
+    std::vector<LinkIncident> incidents;
+};
+// Documents by path
+std::map<std::string, NodeToNodeDoc> NODE_TO_NODE_DOCS;
+
+// Adds a node pair to a <node-pair> element: the node the packets leave, then the node they reach
+void insertNodePair(XMLDocument& ntnXmlFile, XMLElement* parent, std::pair<uint32_t,uint32_t> nodePair) {
+    XMLElement* nodePairElement = ntnXmlFile.NewElement("node-pair");
+    XMLElement* nodeIdElement1 = ntnXmlFile.NewElement("node-id");
+    nodeIdElement1->InsertEndChild(ntnXmlFile.NewText(std::to_string(nodePair.first).c_str()));
+    nodePairElement->InsertEndChild(nodeIdElement1);
+    XMLElement* nodeIdElement2 = ntnXmlFile.NewElement("node-id");
+    nodeIdElement2->InsertEndChild(ntnXmlFile.NewText(std::to_string(nodePair.second).c_str()));
+    nodePairElement->InsertEndChild(nodeIdElement2);
+    parent->InsertEndChild(nodePairElement);
+}
+
+// Adds <delay-value> and <timestamp> elements
+void insertDelayValue(XMLDocument& ntnXmlFile, XMLElement* parent, int64_t delayValue, int64_t timestamp) {
+    XMLElement* delayValueElement = ntnXmlFile.NewElement("delay-value");
+    delayValueElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(delayValue).c_str()));
+    parent->InsertEndChild(delayValueElement);
+    XMLElement* timestampElement = ntnXmlFile.NewElement("timestamp");
+    timestampElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(timestamp).c_str()));
+    parent->InsertEndChild(timestampElement);
+}
+
+// Adds <samples> and <ci95> elements
+void insertDelayStats(XMLDocument& ntnXmlFile, XMLElement* parent, uint32_t samples, int64_t ci95) {
+    XMLElement* samplesElement = ntnXmlFile.NewElement("samples");
+    samplesElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(samples).c_str()));
+    parent->InsertEndChild(samplesElement);
+    XMLElement* ci95Element = ntnXmlFile.NewElement("ci95");
+    ci95Element->InsertEndChild(ntnXmlFile.NewText(std::to_string(ci95).c_str()));
+    parent->InsertEndChild(ci95Element);
+}
+
+// Writes the node-to-node document with all the measurements taken so far
+void finalizeNodeToNodeDoc(std::string node_to_node_doc_path) {
+    std::map<std::string, NodeToNodeDoc>::iterator docIt = NODE_TO_NODE_DOCS.find(node_to_node_doc_path);
+    if (docIt == NODE_TO_NODE_DOCS.end()) {
+        return;
+    }
+    const NodeToNodeDoc& doc = docIt->second;
+
+    XMLDocument ntnXmlFile;
+    XMLElement* root = ntnXmlFile.NewElement("network-measurements");
+    ntnXmlFile.InsertEndChild(root);
+
+    // Incidents still open have no <end>
+    XMLElement* incidentsElement = ntnXmlFile.NewElement("incidents");
+    root->InsertEndChild(incidentsElement);
+    for (const LinkIncident& incident : doc.incidents) {
+        XMLElement* incidentElement = ntnXmlFile.NewElement("incident");
+        XMLElement* kindElement = ntnXmlFile.NewElement("kind");
+        kindElement->InsertEndChild(ntnXmlFile.NewText(incident.kind.c_str()));
+        incidentElement->InsertEndChild(kindElement);
+        insertNodePair(ntnXmlFile, incidentElement, incident.nodePair);
+        XMLElement* startElement = ntnXmlFile.NewElement("start");
+        startElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(incident.start).c_str()));
+        incidentElement->InsertEndChild(startElement);
+        if (incident.end >= 0) {
+            XMLElement* endElement = ntnXmlFile.NewElement("end");
+            endElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(incident.end).c_str()));
+            incidentElement->InsertEndChild(endElement);
+        }
+        XMLElement* peakDelayElement = ntnXmlFile.NewElement("peak-delay");
+        peakDelayElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(incident.peakDelay).c_str()));
+        incidentElement->InsertEndChild(peakDelayElement);
+        incidentsElement->InsertEndChild(incidentElement);
+    }
+
+    XMLElement* delaysElement = ntnXmlFile.NewElement("delays");
+    root->InsertEndChild(delaysElement);
+    for (const NodeToNodeSeries& series : doc.series) {
+        XMLElement* delayElement = ntnXmlFile.NewElement("delay");
+        insertNodePair(ntnXmlFile, delayElement, series.nodePair);
+        XMLElement* measurementsElement = ntnXmlFile.NewElement("measurements");
+        for (const NodeToNodeMeasurement& measurement : series.measurements) {
+            XMLElement* measurementElement = ntnXmlFile.NewElement("measurement");
+            insertDelayValue(ntnXmlFile, measurementElement, measurement.delayValue, measurement.timestamp);
+            insertDelayStats(ntnXmlFile, measurementElement, measurement.samples, measurement.ci95);
+            measurementsElement->InsertEndChild(measurementElement);
+        }
+        delayElement->InsertEndChild(measurementsElement);
+        delaysElement->InsertEndChild(delayElement);
+    }
+
+    ntnXmlFile.SaveFile(node_to_node_doc_path.c_str());
+}
+
+// Opens an incident of a link. Returns its index in the document
+int64_t openIncident(NodeToNodeDoc& doc, const NodeToNodeSeries& series, const std::string& kind, int64_t start, int64_t delayValue) {
+    doc.incidents.push_back(LinkIncident{kind, series.nodePair, start, -1, delayValue});
+    doc.log << "incident-start " << kind << " " << series.nodePair.first << " " << series.nodePair.second << " " << start << "\n";
+    return doc.incidents.size() - 1;
+}
+
+// Closes an open incident of a link
+void closeIncident(NodeToNodeDoc& doc, int64_t& incidentIndex, int64_t end) {
+    LinkIncident& incident = doc.incidents[incidentIndex];
+    incident.end = end;
+    doc.log << "incident-end " << incident.kind << " " << incident.nodePair.first << " " << incident.nodePair.second << " " << end
+            << " " << incident.peakDelay << "\n";
+    incidentIndex = -1;
+}
+
+// Feeds a measurement of a link to its CUSUM. A "change" incident starts when the
+// delay has been drifting above the baseline for long enough, and ends with the first
+// measurement back within the tolerated increase. The baseline only follows the delay
+// while the CUSUM is at 0, so a slow shift can't drag it along
+void detectDelayChange(NodeToNodeDoc& doc, NodeToNodeSeries& series, double delay, int64_t timestamp) {
+    if (series.measurements.size() == 1) {
+        series.baseline = delay;
+        return;
+    }
+    double drift = std::max(CUSUM_RELATIVE_DRIFT * series.baseline, static_cast<double>(CUSUM_MIN_DRIFT.GetNanoSeconds()));
+    if (series.cusum == 0) {
+        series.cusumSince = timestamp;
+    }
+    series.cusum = std::max(0.0, series.cusum + delay - series.baseline - drift);
+
+    if (series.changeIncident < 0) {
+        if (series.cusum > CUSUM_ALARM_DRIFTS * drift) {
+            // The change started when the CUSUM left 0
+            series.changeIncident = openIncident(doc, series, "change", series.cusumSince, std::llround(delay));
+        } else if (series.cusum == 0) {
+            series.baseline += CUSUM_BASELINE_WEIGHT * (delay - series.baseline);
+        }
+        return;
+    }
+    LinkIncident& incident = doc.incidents[series.changeIncident];
+    incident.peakDelay = std::max(incident.peakDelay, static_cast<int64_t>(std::llround(delay)));
+    if (delay <= series.baseline + drift) {
+        series.cusum = 0;
+        closeIncident(doc, series.changeIncident, timestamp);
+    }
+}
+
+// Records the node-to-node delays of a trigger in a document and its log, and updates
+// the incidents of the links. The K + 1 worst links of the trigger are kept in a bounded
+// heap, so ranking costs O(links log K). They are ranked on the lower bound of the 95%
+// confidence interval of their delay, so a link needs enough samples to rank high.
+// A link of the worst K only counts the trigger when its delay is significantly above
+// the (K + 1)-th link's, or the last ranked one's when fewer links were measured.
+// Returns the worst link that has stayed among the worst for a while, if any
+std::optional<std::pair<uint32_t,uint32_t>> recordNodeToNodeDelays(NodeToNodeDoc& doc, const LinkDelays& linkDelays, const UnattributedHops& unattributed, int64_t timestamp) {
+    // (lower bound of the delay, index in series), the best of the K on top
+    typedef std::pair<double,size_t> RankedLink;
+    std::priority_queue<RankedLink, std::vector<RankedLink>, std::greater<RankedLink>> topK;
+    for (const auto& [nodePair, delay] : linkDelays) {
+        double ci95 = delay.ci95HalfWidth();
+        NodeToNodeMeasurement measurement{std::llround(delay.mean), timestamp, delay.samples,
+                                          std::isfinite(ci95) ? std::llround(ci95) : -1};
+        uint64_t key = (static_cast<uint64_t>(nodePair.first) << 32) | nodePair.second;
+        auto insert = doc.seriesIndex.try_emplace(key, doc.series.size());
+        if (insert.second) {
+            doc.series.push_back(NodeToNodeSeries{nodePair, {}});
+        }
+        NodeToNodeSeries& series = doc.series[insert.first->second];
+        series.measurements.push_back(measurement);
+        doc.log << "delay " << nodePair.first << " " << nodePair.second << " " << measurement.delayValue << " " << timestamp
+                << " " << measurement.samples << " " << measurement.ci95 << "\n";
+
+        detectDelayChange(doc, series, delay.mean, timestamp);
+        if (WORST_LINKS_K > 0 && std::isfinite(ci95)) {
+            topK.emplace(delay.mean - ci95, insert.first->second);
+            if (topK.size() > WORST_LINKS_K + 1) {
+                topK.pop();
+            }
+        }
+    }
+
+    // Worst first
+    std::vector<size_t> ranking(topK.size());
+    for (size_t i = ranking.size(); i > 0; --i) {
+        ranking[i - 1] = topK.top().second;
+        topK.pop();
+    }
+    // The reference the worst K are tested against. A single link has none, and counts
+    std::optional<size_t> reference;
+    if (ranking.size() > WORST_LINKS_K) {
+        reference = ranking.back();
+        ranking.pop_back();
+    } else if (ranking.size() > 1) {
+        reference = ranking.back();
+    }
+    if (reference.has_value()) {
+        const LinkDelayStats& referenceDelay = linkDelays.at(doc.series[reference.value()].nodePair);
+        ranking.erase(std::remove_if(ranking.begin(), ranking.end(), [&](size_t index) {
+            return !significantlyWorse(linkDelays.at(doc.series[index].nodePair), referenceDelay);
+        }), ranking.end());
+    }
+    if (!unattributed.empty()) {
+        doc.log << "unattributed " << timestamp;
+        for (const auto& [nodePair, sightings] : unattributed) {
+            doc.log << " " << nodePair.first << " " << nodePair.second << " " << sightings;
+        }
+        doc.log << "\n";
+    }
+    doc.log << "top-k " << timestamp;
+    for (size_t index : ranking) {
+        doc.series[index].lastInTopK = timestamp;
+        doc.log << " " << doc.series[index].nodePair.first << " " << doc.series[index].nodePair.second;
+    }
+    doc.log << "\n";
+
+    // Hysteresis: links not measured by this trigger count as out of the worst K
+    for (NodeToNodeSeries& series : doc.series) {
+        if (series.lastInTopK != timestamp) {
+            series.triggersInTopK = 0;
+            ++series.triggersOutOfTopK;
+            if (series.worstIncident >= 0 && series.triggersOutOfTopK >= WORST_LINK_HYSTERESIS) {
+                closeIncident(doc, series.worstIncident, timestamp);
+            }
+            continue;
+        }
+        if (series.triggersInTopK == 0) {
+            series.inTopKSince = timestamp;
+        }
+        ++series.triggersInTopK;
+        series.triggersOutOfTopK = 0;
+        int64_t delayValue = series.measurements.back().delayValue;
+        if (series.worstIncident >= 0) {
+            LinkIncident& incident = doc.incidents[series.worstIncident];
+            incident.peakDelay = std::max(incident.peakDelay, delayValue);
+        } else if (series.triggersInTopK >= WORST_LINK_HYSTERESIS) {
+            series.worstIncident = openIncident(doc, series, "worst", series.inTopKSince, delayValue);
+        }
+    }
+    doc.log.flush();
+
+    for (size_t index : ranking) {
+        if (doc.series[index].worstIncident >= 0) {
+            return doc.series[index].nodePair;
+        }
+    }
+    return std::nullopt;
+}
+
+// Copies the hops of every flow since the last reset, one (packetId, nodeId, delay)
+// row per probe that saw each packet. Only the probes that recorded hops of a flow
+// are visited. ResetAllStats clears their lists, so they hold this window only
+std::vector<std::vector<PacketHop>> snapshotFlowHops(Ptr<FlowMonitor> monitor) {
+    const FlowMonitor::FlowStatsContainer& stats = monitor->GetFlowStats();
+    std::vector<std::vector<PacketHop>> flows;
+    flows.reserve(stats.size());
+    for (const auto& [flowId, flowStats] : stats) {
+        std::vector<PacketHop>& hops = flows.emplace_back();
+        for (ns3::Ptr<ns3::FlowProbe> probe : monitor->GetFlowObservers(flowId)) {
+            BigBrotherHopStore* bigBrotherProbe = BigBrotherHopStore::Get(probe);
+            const std::vector<BigBrotherHopStore::Hop>* flowHops = bigBrotherProbe->GetFlowHops(flowId);
+            if (!flowHops) {
+                continue;
+            }
+            for (const BigBrotherHopStore::Hop& hop : *flowHops) {
+                // Observation: We're storing the delay from first probe of each node
+                hops.push_back(PacketHop{hop.packetId, bigBrotherProbe->m_nodeId, hop.stats.delayFromFirstProbe.GetNanoSeconds()});
+            }
+        }
+    }
+    return flows;
+}
+
+// Rebuilds the path of every packet and accumulates the delays of the links between
+// the probed nodes. Sorted by packetId and then by delay, the hops of a flow list the
+// nodes of each packet in the order it went through them
+LinkDelays joinFlowHops(std::vector<std::vector<PacketHop>>& flows, const NodeAdjacency& adjacency, UnattributedHops& unattributed) {
+    LinkDelays linkDelays;
+    std::vector<PacketHop> scratch;
+    for (std::vector<PacketHop>& hops : flows) {
+        radixSortPacketHops(hops, scratch);
+        joinPacketHops(hops, adjacency, linkDelays, unattributed);
+    }
+    return linkDelays;
+}
+
+// Number of threads analysing the node-to-node triggers, 0 to analyse them inline
+uint32_t ANALYSIS_THREADS = 0;
+
+// Result of a trigger analysed in the background
+struct NodeToNodeResult {
+    std::string node_to_node_doc_path;
+    int64_t timestamp; // Simulation time of the snapshot, in ns
+    std::optional<std::pair<uint32_t,uint32_t>> worstLink;
+};
+
+// Worker threads that analyse the snapshots of the triggers while the simulation goes on.
+// The snapshots are joined in parallel, but each document records them in the order
+// they were taken, so the files and the incidents don't depend on the scheduling.
+// Results are drained by the next report, which waits for the snapshots taken before it:
+// what a report logs is deterministic too
+struct NodeToNodePipeline {
+    struct Job {
+        NodeToNodeDoc* doc;
+        std::string node_to_node_doc_path;
+        int64_t timestamp;
+        uint64_t sequence; // Order of the snapshot in its document
+        const NodeAdjacency* adjacency; // Links between the probed nodes, never freed
+        std::vector<std::vector<PacketHop>> flows;
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    std::deque<Job> jobs;
+    size_t pending = 0;
+    bool stopping = false;
+    std::vector<NodeToNodeResult> results;
+    // Document -> (snapshots submitted, snapshots recorded)
+    std::map<NodeToNodeDoc*, std::pair<uint64_t,uint64_t>> sequences;
+
+    ~NodeToNodePipeline() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void submit(NodeToNodeDoc& doc, const std::string& node_to_node_doc_path, int64_t timestamp, const NodeAdjacency& adjacency, std::vector<std::vector<PacketHop>> flows) {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (workers.size() < ANALYSIS_THREADS) {
+            workers.emplace_back(&NodeToNodePipeline::work, this);
+        }
+        uint64_t sequence = sequences[&doc].first++;
+        jobs.push_back(Job{&doc, node_to_node_doc_path, timestamp, sequence, &adjacency, std::move(flows)});
+        ++pending;
+        jobReady.notify_one();
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) {
+                return;
+            }
+            Job job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            UnattributedHops unattributed;
+            LinkDelays linkDelays = joinFlowHops(job.flows, *job.adjacency, unattributed);
+            lock.lock();
+            // Jobs are taken in order, so the earlier snapshots of the document are
+            // already being recorded by other workers
+            jobDone.wait(lock, [&] { return sequences[job.doc].second == job.sequence; });
+            lock.unlock();
+            std::optional<std::pair<uint32_t,uint32_t>> worstLink = recordNodeToNodeDelays(*job.doc, linkDelays, unattributed, job.timestamp);
+            lock.lock();
+            ++sequences[job.doc].second;
+            results.push_back(NodeToNodeResult{job.node_to_node_doc_path, job.timestamp, worstLink});
+            --pending;
+            jobDone.notify_all();
+        }
+    }
+
+    // Waits for every snapshot submitted so far
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobDone.wait(lock, [this] { return pending == 0; });
+    }
+
+    // Waits for every snapshot submitted so far, and moves the results of a document into
+    // drained, in snapshot order. The results of the other documents stay for their own reports
+    void drain(const std::string& node_to_node_doc_path, std::vector<NodeToNodeResult>& drained) {
+        std::unique_lock<std::mutex> lock(mutex);
+        jobDone.wait(lock, [this] { return pending == 0; });
+        size_t first = drained.size();
+        auto kept = std::stable_partition(results.begin(), results.end(), [&](const NodeToNodeResult& result) {
+            return result.node_to_node_doc_path != node_to_node_doc_path;
+        });
+        std::move(kept, results.end(), std::back_inserter(drained));
+        results.erase(kept, results.end());
+        std::stable_sort(drained.begin() + first, drained.end(), [](const NodeToNodeResult& a, const NodeToNodeResult& b) {
+            return a.timestamp < b.timestamp;
+        });
+    }
+};
+NodeToNodePipeline NODE_TO_NODE_PIPELINE;
+
+// Writes the document once its pending snapshots are recorded
+void closeNodeToNodeDoc(std::string node_to_node_doc_path) {
+    NODE_TO_NODE_PIPELINE.wait();
+    finalizeNodeToNodeDoc(node_to_node_doc_path);
+}
+
+// Gets the document of a path, starting its log on first use
+NodeToNodeDoc& getNodeToNodeDoc(const std::string& node_to_node_doc_path) {
+    auto insert = NODE_TO_NODE_DOCS.try_emplace(node_to_node_doc_path);
+    NodeToNodeDoc& doc = insert.first->second;
+    if (insert.second) {
+        std::string logPath = node_to_node_doc_path + ".log";
+        doc.log.open(logPath.c_str(), std::ofstream::out | std::ofstream::trunc);
+        if (!doc.log.is_open()) {
+            std::cerr << "Can't open file " << logPath << std::endl;
+        }
+        Simulator::ScheduleDestroy(&closeNodeToNodeDoc, node_to_node_doc_path);
+    }
+    return doc;
+}
+
 std::optional<std::pair<int64_t,int64_t>> nodeToNodeTrigger(Ptr<FlowMonitor> monitor, std::string node_to_node_doc_path)
 // This function implements the first step in looking for the cause of a bad metric
 // Given a flow_id, we look for the worst performing FlowProbes
 {
-    XMLDocument ntnXmlFile; 
-    XMLError result = ntnXmlFile.LoadFile(node_to_node_doc_path.c_str());
-    if (result != XML_SUCCESS && result != XML_ERROR_EMPTY_DOCUMENT) {
-        // Handle error
-        std::cerr << "Error loading file: " << ntnXmlFile.ErrorIDToName(result) << std::endl;
+    NodeToNodeDoc& doc = getNodeToNodeDoc(node_to_node_doc_path);
+
+    // The per-hop records are cleared by the next ResetAllStats(), so they are copied
+    // now. With ANALYSIS_THREADS, the rest runs in the background and the result
+    // is logged by the next report
+    const NodeAdjacency& adjacency = getProbedAdjacency(monitor);
+    std::vector<std::vector<PacketHop>> flows = snapshotFlowHops(monitor);
+    int64_t timestamp = Simulator::Now().GetNanoSeconds();
+    if (ANALYSIS_THREADS > 0) {
+        NODE_TO_NODE_PIPELINE.submit(doc, node_to_node_doc_path, timestamp, adjacency, std::move(flows));
         return std::nullopt;
-    } 
-
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
-    FlowMonitor::FlowProbeContainer probes = monitor->GetAllProbes();
-    std::map<std::pair<uint32_t,uint32_t>,ns3::Time> nodeToNodeDelay;
-
-    // Get the root element
-    XMLElement* root = ntnXmlFile.FirstChildElement("network-measurements");
-    if (!root) {
-        // Create the root element if it doesn't exist
-        root = ntnXmlFile.NewElement("network-measurements");
-        ntnXmlFile.InsertEndChild(root);
-    }
-
-    XMLElement* delaysElement = root->FirstChildElement("delays");
-    if (!delaysElement) {
-        // Create the 'delays' element if it doesn't exist
-        delaysElement = ntnXmlFile.NewElement("delays");
-        root->InsertEndChild(delaysElement);
-    }
-
-    for (FlowMonitor::FlowStatsContainer::const_iterator flowStatsIt = stats.begin();
-        flowStatsIt != stats.end();
-        ++flowStatsIt)
-    {
-        FlowId flowId = flowStatsIt->first;  
-        /* The variable perPacketStats is meant to be the structure that'll keep the information
-        of the path each packet went through, as well as how much delay since first transmission each probe reported.
-        Because of this, it's a map of packet Ids to a vector of pairs, where each pair stores a nodeId
-        and a time value, representing the delay introduced measured so far by the time the packet reached 
-        each node.  */
-        std::map<uint32_t,std::vector<std::pair<uint32_t,ns3::Time>>> perPacketStats;
-
-        /* 
-        For each packet sent(not necessarely recived) in the flow.We'll
-            1- Access each probe involved in the flow
-            2- Check if the specific packet went through it
-            3- If it did, we'll extract the delay from the bigBrotherStats.
-            4- Create an adequate entry for perPacketStats
-        */
-        // Step 1
-        for (ns3::Ptr<ns3::FlowProbe> probe : probes)
-        {
-            FlowProbe::Stats probeStats = probe->GetStats();
-            Ptr<BigBrotherFlowProbe> bigBrotherProbe = DynamicCast<BigBrotherFlowProbe>(probe);
-            // We only measure in the probes that are ipv4/bigBrother
-            if (bigBrotherProbe)
-            {
-                std::map<FlowId,uint32_t>::const_iterator it = bigBrotherProbe->m_packetStartIndex.find(flowId);
-                if (it != bigBrotherProbe->m_packetStartIndex.end()){
-                    uint32_t startIndex = it->second;
-                    for (uint32_t packetId = startIndex; packetId < startIndex + flowStatsIt->second.rxPackets; ++packetId)
-                    {
-                        std::map<std::pair<uint32_t,uint32_t>, FlowProbe::FlowStats>::const_iterator it = bigBrotherProbe->m_perPacketStats.find(std::make_pair(flowId, packetId));
-                        // Step 2
-                        if (it != bigBrotherProbe->m_perPacketStats.end())
-                        {
-                            // Step 3
-                            FlowProbe::FlowStats flowProbeStats = it->second;
-                            // Now we'll insert the extracted delay to the corresponding packet id's entry's vector
-                            // While being carefull of creating this vector if it doesn't yet exist, and appending 
-                            // to it otherwise.
-                            std::map<uint32_t,std::vector<std::pair<uint32_t,ns3::Time>>>::iterator perPacketStatsIt = perPacketStats.find(packetId);
-                            std::vector<std::pair<uint32_t,ns3::Time>> nodeAcc;
-                            if (perPacketStatsIt != perPacketStats.end())
-                            {
-                                nodeAcc = perPacketStatsIt->second;
-                            }
-                            // Observation: We're storing the delay from first probe of each node
-                            nodeAcc.push_back(std::make_pair(bigBrotherProbe->m_nodeId,flowProbeStats.delayFromFirstProbeSum));
-                            try 
-                            {
-                                // Step 4
-                                perPacketStats.insert_or_assign(packetId, nodeAcc);
-                            } catch (const std::exception& e)
-                            {
-                                std::cerr << "Error inserting into perPacketStats: " << e.what() << std::endl;
-                            }
-                        }
-
-                    } 
-                }
-            }
-        
-        }
-
-        // packetId -> vector of (node,delay)
-        for(std::map<uint32_t,std::vector<std::pair<uint32_t,ns3::Time>>>::const_iterator it = perPacketStats.begin(); it != perPacketStats.end(); ++it)
-        {   
-            std::vector<std::pair<uint32_t,ns3::Time>> nodesDelay = it->second;
-            std::sort(nodesDelay.begin(), nodesDelay.end(), compareByTime);
-            for(size_t i = 0; i < nodesDelay.size() - 1;++i)
-            {
-                // We insert the pairs with the lesser nodeId first, and the delay of the second
-                uint32_t firstNode;
-                uint32_t secondNode;
-                if (nodesDelay[i].first < nodesDelay[i+1].first)
-                {
-                    firstNode = nodesDelay[i].first ;
-                    secondNode = nodesDelay[i+1].first ;
-                } else 
-                {
-                    firstNode = nodesDelay[i+1].first ;
-                    secondNode = nodesDelay[i].first ;
-                }
-                std::map<std::pair<uint32_t,uint32_t>,ns3::Time>::const_iterator findIt = nodeToNodeDelay.find(std::make_pair(firstNode,secondNode));
-                ns3::Time delayAcc;
-                if (findIt != nodeToNodeDelay.end())
-                {
-                    delayAcc = findIt->second;
-                }
-                //TODO: Maybe worth rethinking this shit innit?
-                // This would override if another packet from whichever flow, had passed between those nodes before
-                //The measure of delay to every node-to-node metric, is the avg for every package
-                delayAcc = (nodesDelay[i+1].second - nodesDelay[i].second); 
-                // delayAcc += (nodesDelay[i+1].second - nodesDelay[i].second)/maxPacketId;
-                nodeToNodeDelay.insert_or_assign(std::make_pair(firstNode,secondNode),delayAcc );
+    }
+
+    // Only this trigger's measurements are written: the document is assembled at the end
+    UnattributedHops unattributed;
+    LinkDelays linkDelays = joinFlowHops(flows, adjacency, unattributed);
+    std::optional<std::pair<uint32_t,uint32_t>> worstLink =
+        recordNodeToNodeDelays(doc, linkDelays, unattributed, timestamp);
+    if (!worstLink.has_value()) {
+        return std::nullopt;
+    }
+    return std::make_pair(worstLink.value().first, worstLink.value().second);
+}
+void nodeToNodeTriggerVoidWrapper(Ptr<FlowMonitor> monitor, std::string node_to_node_doc_path) {
+    nodeToNodeTrigger(monitor,node_to_node_doc_path);
+}
+
+// Path of the log --> tomography, keeping the routes traced by previous triggers
+std::map<std::string, Ipv4LinkTomography> TOMOGRAPHIES;
+
+// Infers the delay of every link from the end-to-end delays of the flows, so the
+// monitor only needs probes on the edge nodes. When the probes of the monitor also
+// recorded the hops of the packets (installed on every node), the delays measured
+// link by link are logged next to the inferred ones to validate the inference
+void tomographyTrigger(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, std::string tomography_log_path) {
+    Ipv4LinkTomography& tomography = TOMOGRAPHIES[tomography_log_path];
+    tomography.Clear();
+    uint32_t paths = tomography.AddFlows(monitor, classifier);
+    Ipv4LinkTomography::LinkEstimates estimates = tomography.Solve();
+
+    const NodeAdjacency& adjacency = getProbedAdjacency(monitor);
+    std::vector<std::vector<PacketHop>> flows = snapshotFlowHops(monitor);
+    UnattributedHops unattributed;
+    LinkDelays measured = joinFlowHops(flows, adjacency, unattributed);
+
+    std::ofstream log(tomography_log_path.c_str(), std::ofstream::out | std::ofstream::app);
+    if (!log.is_open()) {
+        std::cerr << "Can't open file " << tomography_log_path << std::endl;
+        return;
+    }
+    int64_t timestamp = Simulator::Now().GetNanoSeconds();
+    log << "timestamp=" << timestamp << " paths=" << paths << " links=" << estimates.size() << std::endl;
+    for (const auto& [link, estimate] : estimates) {
+        log << "timestamp=" << timestamp << " link=" << link.first << "-" << link.second
+            << " inferred=" << estimate.delay.GetNanoSeconds() << " paths=" << estimate.paths
+            << " identifiable=" << estimate.identifiable;
+        // The inference assumes symmetric links: both directions are measured together
+        LinkDelayStats linkMeasured;
+        for (std::pair<uint32_t,uint32_t> direction : {link, std::make_pair(link.second, link.first)}) {
+            auto measuredIt = measured.find(direction);
+            if (measuredIt != measured.end()) {
+                linkMeasured.merge(measuredIt->second);
             }
         }
+        if (linkMeasured.samples > 0) {
+            int64_t measuredDelay = std::llround(linkMeasured.mean);
+            log << " measured=" << measuredDelay
+                << " error=" << estimate.delay.GetNanoSeconds() - measuredDelay;
+        }
+        log << std::endl;
     }
-    
-    ns3::Time maxDelay;
-    std::pair<uint32_t,uint32_t> maxDelayIndex;
-    
-    for(std::map<std::pair<uint32_t,uint32_t>,ns3::Time>::iterator nodeToNodeDelayIt = nodeToNodeDelay.begin();nodeToNodeDelayIt != nodeToNodeDelay.end() ; ++nodeToNodeDelayIt)
-    {
-        // Check if the 'delay' element for this node pair already exists
-        XMLElement* delayElement = delaysElement->FirstChildElement("delay");
-        while (delayElement) {
-            XMLElement* nodePairElement = delayElement->FirstChildElement("node-pair");
-            if (nodePairElement) {
-                uint32_t nodeId1 = std::stoul(nodePairElement->FirstChildElement("node-id")->GetText());
-                uint32_t nodeId2 = std::stoul(nodePairElement->LastChildElement("node-id")->GetText());
-                if (nodeId1 == nodeToNodeDelayIt->first.first && nodeId2 == nodeToNodeDelayIt->first.second) {
-                    // The 'delay' element for this node pair already exists, append the new measurement
-                    break;
-                }
-            }
-            delayElement = delayElement->NextSiblingElement("delay");
+}
+
+// Size of the write buffer of every report stream, in bytes: it is written to the
+// file when full
+uint32_t REPORT_BUFFER_BYTES = 1 << 20;
+// The buffers are also written when a report finds this much simulation time since
+// the last write, so the files can be followed during long runs. 0 writes every report
+ns3::Time REPORT_FLUSH_INTERVAL = Seconds(10);
+// Format of the _stats.dat rows, a name of STATS_FORMATS
+std::string STATS_FORMAT = "tsv";
+
+// Five-tuple of a flow of either address family, as the reports describe it
+typedef std::variant<Ipv4FlowClassifier::FiveTuple, Ipv6FlowClassifier::FiveTuple> FlowKey;
+
+// Writes the _stats.dat records of the reports: a row per report, with the throughput
+// (Mbps), mean delay and mean jitter (ms) of every flow, then of all the flows
+struct StatsFormat {
+    virtual ~StatsFormat() = default;
+    // Once, when the file is created
+    virtual void writeHeader(std::ostream& out) {}
+    virtual void beginReport(std::ostream& out, int64_t timeMs) = 0;
+    // For every active flow, before its stats
+    virtual void describeFlow(std::ostream& out, FlowId flowId, const FlowKey& key) {}
+    // For every flow of the monitor; inactive flows have no stats this report
+    virtual void writeFlow(std::ostream& out, FlowId flowId, bool active, const TrackedStats& flow) = 0;
+    virtual void endReport(std::ostream& out, const TrackedStats& flows) = 0;
+};
+
+// The original columns, tab-separated, inactive flows as zeros
+struct TsvStatsFormat : StatsFormat {
+    const char* separator;
+    explicit TsvStatsFormat(const char* separator = "\t") : separator(separator) {}
+    void beginReport(std::ostream& out, int64_t timeMs) override {
+        out << timeMs;
+    }
+    void writeFlow(std::ostream& out, FlowId flowId, bool active, const TrackedStats& flow) override {
+        if (!active) {
+            out << separator << "0.000000" << separator << "0.000000" << separator << "0.000000";
+            return;
         }
+        out << separator << flow.throughput << separator << (flow.meanDelay.GetDouble()/1000000) << separator << (flow.meanJitter.GetDouble()/1000000);
+    }
+    void endReport(std::ostream& out, const TrackedStats& flows) override {
+        out << separator << (flows.flowsAverageDelay.GetDouble() / 1000000) << separator << flows.flowsAverageThroughput
+            << separator << (flows.flowsAverageMeanJitter.GetDouble()/1000000) << "\n";
+    }
+};
 
-        if (!delayElement) {
-            // The 'delay' element for this node pair doesn't exist, create a new one
-            delayElement = ntnXmlFile.NewElement("delay");
-            delaysElement->InsertEndChild(delayElement);
+// Self-describing records, one per line and tab-separated, whose first field is their
+// type. The header block describes the records, and a flow is described by an F
+// record, with its five-tuple, before its first S record. The records are written as
+// the reports go, so flows appearing mid-run don't move anything. Inactive flows have
+// no S record. E.g. the aggregates with grep '^A', the samples of flow 3 with
+// awk -F'\t' '$1 == "S" && $3 == 3'
+struct LongStatsFormat : StatsFormat {
+    std::unordered_set<FlowId> described;
+    int64_t timeMs = 0;
+    void writeHeader(std::ostream& out) override {
+        out << "# big-brother flow stats, long format, version 1\n"
+            << "# F\tflowId\tsourceAddress\tsourcePort\tdestinationAddress\tdestinationPort\tprotocol\n"
+            << "# S\ttimeMs\tflowId\tthroughputMbps\tmeanDelayMs\tmeanJitterMs\tlastPacketDelayMs\n"
+            << "# A\ttimeMs\taverageThroughputMbps\taverageDelayMs\taverageJitterMs\tmedianDelayMs\n";
+    }
+    void beginReport(std::ostream& out, int64_t reportTimeMs) override {
+        timeMs = reportTimeMs;
+    }
+    void describeFlow(std::ostream& out, FlowId flowId, const FlowKey& key) override {
+        if (!described.insert(flowId).second) {
+            return;
+        }
+        std::visit([&](const auto& tuple) {
+            out << "F\t" << flowId << "\t" << tuple.sourceAddress << "\t" << tuple.sourcePort << "\t"
+                << tuple.destinationAddress << "\t" << tuple.destinationPort << "\t" << uint16_t(tuple.protocol) << "\n";
+        }, key);
+    }
+    void writeFlow(std::ostream& out, FlowId flowId, bool active, const TrackedStats& flow) override {
+        if (!active) {
+            return;
+        }
+        out << "S\t" << timeMs << "\t" << flowId << "\t" << flow.throughput << "\t" << flow.meanDelay.GetDouble() / 1000000
+            << "\t" << flow.meanJitter.GetDouble() / 1000000 << "\t" << flow.lastPacketDelay.GetDouble() / 1000000 << "\n";
+    }
+    void endReport(std::ostream& out, const TrackedStats& flows) override {
+        out << "A\t" << timeMs << "\t" << flows.flowsAverageThroughput << "\t" << flows.flowsAverageDelay.GetDouble() / 1000000
+            << "\t" << flows.flowsAverageMeanJitter.GetDouble() / 1000000 << "\t" << flows.delayValuesMedian.GetDouble() / 1000000 << "\n";
+    }
+};
+
+// Formats by name. Scenarios can register their own before the first report
+std::map<std::string, std::function<std::unique_ptr<StatsFormat>()>> STATS_FORMATS = {
+    {"tsv", [] { return std::make_unique<TsvStatsFormat>(); }},
+    {"csv", [] { return std::make_unique<TsvStatsFormat>(","); }},
+    {"long", [] { return std::make_unique<LongStatsFormat>(); }},
+};
+
+// A file of the reports, open for the whole run behind a large buffer
+struct ReportStream {
+    std::string path;
+    std::vector<char> buffer; // Declared before the file, which writes it out when destroyed
+    std::ofstream file;
+    int64_t lastFlush = 0; // Simulation time of the last write, in ns
+
+    void open(const std::string& streamPath, std::ios_base::openmode mode) {
+        path = streamPath;
+        buffer.resize(REPORT_BUFFER_BYTES);
+        // The buffer must be set before the file is opened
+        if (!buffer.empty()) {
+            file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        }
+        file.open(path.c_str(), mode);
+        if (!file.is_open()) {
+            std::cerr << "Can't open file " << path << std::endl;
+        }
+        file.setf(std::ios_base::fixed);
+        lastFlush = Simulator::Now().GetNanoSeconds();
+    }
+
+    // now is the simulation time of the report, in ns
+    void flushIfDue(int64_t now) {
+        if (now - lastFlush >= REPORT_FLUSH_INTERVAL.GetNanoSeconds()) {
+            file.flush();
+            lastFlush = now;
+        }
+    }
+};
+
+// Output of the reports of a monitoring session: the flow performance log and the
+// stats, created by the first report and closed when the simulation is destroyed
+struct ReportSink {
+    ReportStream eteLogs;
+    ReportStream stats;
+    std::unique_ptr<StatsFormat> statsFormat;
+};
+// Sinks by file name prefix
+std::map<std::string, ReportSink> REPORT_SINKS;
+
+// Logs the KPIs of a flow that deviate from its baseline
+void logFlowAnomaly(std::ostream& log, FlowId flowId, const FlowAnomalyDetector::Result& anomaly) {
+    for (int k = 0; k < FlowAnomalyDetector::N_KPIS; k++) {
+        const FlowAnomalyDetector::Deviation& deviation = anomaly.kpis[k];
+        if (!deviation.anomalous) {
+            continue;
+        }
+        FlowAnomalyDetector::Kpi kpi = static_cast<FlowAnomalyDetector::Kpi>(k);
+        // Throughput in Mbps, delay and jitter in ms
+        double scale = kpi == FlowAnomalyDetector::THROUGHPUT ? 1 : 1000;
+        const char* unit = kpi == FlowAnomalyDetector::THROUGHPUT ? " Mbps" : " ms";
+        log << "\t\tAnomalous " << FlowAnomalyDetector::GetKpiName(kpi) << " of flow " << flowId << ": "
+            << deviation.value * scale << unit << ", baseline " << deviation.mean * scale << unit
+            << " (z-score " << deviation.zScore << ", " << deviation.relative * 100 << "% worse)\n";
+    }
+}
+
+// RTT of a TCP conversation, as a report logs it
+struct RttSummary {
+    uint32_t samples;
+    Time mean, min, max;
+    double p50, p95; // s
+};
+
+// Radio segment of the packets of a flow, as a report logs it. Each packet is split
+// by the NrFlowProbe of its receiving side: the UE in DL, the gNB in UL
+struct RadioSummary {
+    uint32_t packets;
+    Time bufferWait; // Mean time queued at the transmitter's RLC
+    Time airDelay; // Mean time from the RLC transmission up to the reception
+};
+
+// A flow of a report, copied from the monitor and the classifier so the report can be
+// written after the stats are reset
+struct FlowReportRow {
+    FlowId flowId;
+    bool active; // Inactive flows only fill their place in the stats
+    FlowKey key;
+    uint64_t txBytes;
+    uint64_t rxBytes;
+    uint32_t txPackets;
+    uint32_t rxPackets;
+    FlowId reverseFlowId;
+    std::optional<RttSummary> rtt;
+    std::optional<RadioSummary> radio;
+    TrackedStats measurements;
+    std::optional<FlowAnomalyDetector::Result> anomaly; // Only if the flow is anomalous
+};
+
+// What a report writes, taken while the stats can be read. The KPIs and the threshold
+// decision are computed by the report itself, the text is formatted by writeFlowReport
+struct FlowReport {
+    ReportSink* sink;
+    int64_t now; // Simulation time of the report, in ns
+    Time interval; // Measuring interval of the scheduler
+    double duration; // Seconds since the previous report
+    std::vector<NodeToNodeResult> nodeToNode; // Triggers analysed in the background since the previous report
+    std::vector<FlowReportRow> flows;
+    TrackedStats totals;
+    // Threshold decision. A report that takes the baseline makes none
+    bool decided;
+    bool throughputDegraded, delayDegraded, jitterDegraded;
+    float throughputLimit;
+    Time delayLimit, jitterLimit;
+    uint32_t anomalousFlows;
+    std::optional<std::pair<int64_t,int64_t>> worstLink;
+};
 
-            // Create the 'node-pair' element
-            XMLElement* nodePairElement = ntnXmlFile.NewElement("node-pair");
-            delayElement->InsertEndChild(nodePairElement);
+// Writes a report to the files of its session
+void writeFlowReport(const FlowReport& report) {
+    std::ofstream& eteLogsFile = report.sink->eteLogs.file;
+    std::ofstream& statsFile = report.sink->stats.file;
+    StatsFormat& statsFormat = *report.sink->statsFormat;
 
-            // Add the node IDs
-            XMLElement* nodeIdElement1 = ntnXmlFile.NewElement("node-id");
-            nodeIdElement1->InsertEndChild(ntnXmlFile.NewText(std::to_string(nodeToNodeDelayIt->first.first).c_str()));
-            nodePairElement->InsertEndChild(nodeIdElement1);
+    eteLogsFile << "Report flow stats " << NanoSeconds(report.now).As(Time::MS) << ", Current measuring time " << report.interval.As(Time::MS) << "\n";
+    for (const NodeToNodeResult& result : report.nodeToNode) {
+        if (result.worstLink.has_value()) {
+            eteLogsFile << "\tWorst performing link at " << NanoSeconds(result.timestamp).As(Time::MS) << ": ("
+                        << result.worstLink.value().first << "," << result.worstLink.value().second << ")\n";
+        } else {
+            eteLogsFile << "\tNo link among the worst for long enough yet at " << NanoSeconds(result.timestamp).As(Time::MS) << "\n";
+        }
+    }
+    statsFormat.beginReport(statsFile, report.now / 1000000);
 
-            XMLElement* nodeIdElement2 = ntnXmlFile.NewElement("node-id");
-            nodeIdElement2->InsertEndChild(ntnXmlFile.NewText(std::to_string(nodeToNodeDelayIt->first.second).c_str()));
-            nodePairElement->InsertEndChild(nodeIdElement2);
+    for (const FlowReportRow& flow : report.flows) {
+        if (!flow.active) {
+            // Fill the position of the non active flows
+            statsFormat.writeFlow(statsFile, flow.flowId, false, flow.measurements);
+            continue;
+        }
+        statsFormat.describeFlow(statsFile, flow.flowId, flow.key);
+        std::visit([&](const auto& t) {
+            eteLogsFile << "\tFlow " << flow.flowId << " (" << t.sourceAddress << ":" << t.sourcePort << " -> "
+                    << t.destinationAddress << ":" << t.destinationPort << ") proto ";
+            if (t.protocol == 6) {
+                eteLogsFile << "TCP\n";
+            } else if (t.protocol == 17) {
+                eteLogsFile << "UDP\n";
+            } else {
+                eteLogsFile << (uint16_t)t.protocol << "\n";
+            }
+        }, flow.key);
+        eteLogsFile << "\t\tTx Packets: " << flow.txPackets << "\n";
+        eteLogsFile << "\t\tTx Bytes:   " << flow.txBytes << "\n";
+        eteLogsFile << "\t\tTxOffered:  " << flow.txBytes * 8.0 / report.duration / 1000.0 / 1000.0 << " Mbps\n";
+        eteLogsFile << "\t\tRx Packets: " << flow.rxPackets << "\n";
+        eteLogsFile << "\t\tRx Bytes:   " << flow.rxBytes << "\n";
+        if (flow.reverseFlowId != 0) {
+            eteLogsFile << "\t\tReverse flow: " << flow.reverseFlowId << "\n";
         }
+        if (flow.rtt.has_value()) {
+            const RttSummary& r = flow.rtt.value();
+            eteLogsFile << "\t\tRTT: mean " << r.mean.As(Time::MS)
+                        << ", min " << r.min.As(Time::MS) << ", max " << r.max.As(Time::MS)
+                        << ", p50 " << r.p50 * 1000 << " ms"
+                        << ", p95 " << r.p95 * 1000 << " ms"
+                        << " (" << r.samples << " samples)\n";
+        }
+        if (flow.radio.has_value()) {
+            const RadioSummary& r = flow.radio.value();
+            eteLogsFile << "\t\tRadio segment: buffer wait " << r.bufferWait.As(Time::MS)
+                        << ", air delay " << r.airDelay.As(Time::MS)
+                        << " (" << r.packets << " packets)\n";
+        }
+        const TrackedStats& measurements = flow.measurements;
+        eteLogsFile << "\t\tRxDuration: " << measurements.rxDuration << " s\n";
+        eteLogsFile << "\t\tThroughput: " << measurements.throughput << " Mbps\n";
+        eteLogsFile << "\t\tMean delay: "<< measurements.meanDelay.As(Time::MS) << " \n";
+        eteLogsFile << "\t\tLast packet delay: " << measurements.lastPacketDelay.As(Time::MS) << " \n";
+        eteLogsFile << "\t\tMean jitter: " << measurements.meanJitter.As(Time::MS) << "\n";
 
-        // Create the 'measurements' element
-        XMLElement* measurementsElement = delayElement->FirstChildElement("measurements");
-        if (!measurementsElement) {
-            measurementsElement = ntnXmlFile.NewElement("measurements");
-            delayElement->InsertEndChild(measurementsElement);
+        statsFormat.writeFlow(statsFile, flow.flowId, true, measurements);
+        if (flow.anomaly.has_value()) {
+            logFlowAnomaly(eteLogsFile, flow.flowId, flow.anomaly.value());
         }
+    }
 
-        // Create the 'measurement' element
-        XMLElement* measurementElement = ntnXmlFile.NewElement("measurement");
-        measurementsElement->InsertEndChild(measurementElement);
+    const TrackedStats& totals = report.totals;
+    eteLogsFile << "\n\n\tAverage flow throughput: " << totals.flowsAverageThroughput << " Mbps\n";
+    eteLogsFile << "\tAverage flow delay: " << totals.flowsAverageDelay.As(Time::MS) << "\n";
+    eteLogsFile << "\tAverage flow jitter: " << totals.flowsAverageMeanJitter.As(Time::MS) << "\n";
+    eteLogsFile << "\tMedian flow delay: " << totals.delayValuesMedian.As(Time::MS) << "\n\n";
+    statsFormat.endReport(statsFile, totals);
 
-        // Add the delay value and timestamp
-        XMLElement* delayValueElement = ntnXmlFile.NewElement("delay-value");
-        delayValueElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(nodeToNodeDelayIt->second.GetNanoSeconds()).c_str()));
-        measurementElement->InsertEndChild(delayValueElement);
+    if (report.decided) {
+        if (report.throughputDegraded) {
+            eteLogsFile << "\tAverage throughput surpassing threshold: " << totals.flowsAverageThroughput << " < " << report.throughputLimit << "\n";
+        }
+        if (report.delayDegraded) {
+            eteLogsFile << "\tAverage delay surpassing Delay: " << totals.flowsAverageDelay <<  " > " << report.delayLimit << "\n";
+        }
+        if (report.jitterDegraded) {
+            eteLogsFile << "\tAverage Jitter surpassing threshold" << totals.flowsAverageMeanJitter << " > " << report.jitterLimit << "\n";
+        }
+        if (report.anomalousFlows > 0) {
+            eteLogsFile << "\t" << report.anomalousFlows << " flows anomalous against their own baseline\n";
+        }
+        bool triggered = report.throughputDegraded || report.delayDegraded || report.jitterDegraded || report.anomalousFlows > 0;
+        if (!triggered) {
+            eteLogsFile << "\n\t Perforance under threshold(good)\n";
+        } else if (report.worstLink.has_value()) {
+            eteLogsFile << "\tWorst performing link: ("<< report.worstLink.value().first << "," << report.worstLink.value().second << ")\n";
+        } else if (ANALYSIS_THREADS == 0) {
+            eteLogsFile << "\tNo link among the worst for long enough yet\n";
+        }
+    }
+    report.sink->eteLogs.flushIfDue(report.now);
+    report.sink->stats.flushIfDue(report.now);
+}
 
-        XMLElement* timestampElement = ntnXmlFile.NewElement("timestamp");
-        timestampElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(Simulator::Now().GetNanoSeconds()).c_str()));
-        measurementElement->InsertEndChild(timestampElement);
+// Thread writing the reports while the simulation goes on, with ANALYSIS_THREADS. The
+// reports are written in the order they were taken, so the files are the same as when
+// they are written inline. Written reports are handed back to be filled again, so the
+// reports don't allocate once their buffers have grown
+struct ReportWriter {
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable reportReady;
+    std::condition_variable reportWritten;
+    std::deque<FlowReport> reports;
+    std::vector<FlowReport> written;
+    bool writing = false;
+    bool stopping = false;
 
-        if (nodeToNodeDelayIt->second > maxDelay)
+    ~ReportWriter() {
         {
-            maxDelay = nodeToNodeDelayIt->second;
-            maxDelayIndex = nodeToNodeDelayIt->first;
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        reportReady.notify_all();
+        if (thread.joinable()) {
+            thread.join();
         }
+    }
 
+    // Queues the report, and leaves a written one in its place
+    void submit(FlowReport& report) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!thread.joinable()) {
+            thread = std::thread(&ReportWriter::work, this);
+        }
+        reports.push_back(std::move(report));
+        report = FlowReport();
+        if (!written.empty()) {
+            report = std::move(written.back());
+            written.pop_back();
+        }
+        reportReady.notify_one();
     }
 
-    XMLElement* worstLinksElement = root->FirstChildElement("worst-links");
-    if (!worstLinksElement) {
-        worstLinksElement = ntnXmlFile.NewElement("worst-links");
-        root->InsertFirstChild(worstLinksElement);
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            reportReady.wait(lock, [this] { return stopping || !reports.empty(); });
+            if (reports.empty()) {
+                return;
+            }
+            FlowReport report = std::move(reports.front());
+            reports.pop_front();
+            writing = true;
+            lock.unlock();
+            writeFlowReport(report);
+            lock.lock();
+            writing = false;
+            written.push_back(std::move(report));
+            reportWritten.notify_all();
+        }
     }
-    
-    XMLElement* worstLinkElement = ntnXmlFile.NewElement("worst-link");
 
-    // Add the delay value 
-    XMLElement* delayValueElement = ntnXmlFile.NewElement("delay-value");
-    delayValueElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(maxDelay.GetNanoSeconds()).c_str()));
-    worstLinkElement->InsertEndChild(delayValueElement);
-    // Add the timestamp
-    XMLElement* timestampElement = ntnXmlFile.NewElement("timestamp");
-    timestampElement->InsertEndChild(ntnXmlFile.NewText(std::to_string(Simulator::Now().GetNanoSeconds()).c_str()));
-    worstLinkElement->InsertEndChild(timestampElement);
+    // Waits for every report submitted so far
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        reportWritten.wait(lock, [this] { return reports.empty() && !writing; });
+    }
+};
+ReportWriter REPORT_WRITER;
 
-    // Create the 'node-pair' element
-    XMLElement* nodePairElement = ntnXmlFile.NewElement("node-pair");
+void closeReportSink(std::string filename) {
+    REPORT_WRITER.wait();
+    REPORT_SINKS.erase(filename);
+}
 
-    // Add the node IDs
-    XMLElement* nodeIdElement1 = ntnXmlFile.NewElement("node-id");
-    nodeIdElement1->InsertEndChild(ntnXmlFile.NewText(std::to_string(maxDelayIndex.first).c_str()));
-    nodePairElement->InsertEndChild(nodeIdElement1);
+// Gets the sink of a session, opening its files on first use. The first report of a
+// run (truncate) starts the files over, later ones append to them
+ReportSink& getReportSink(const std::string& filename, bool truncate) {
+    auto insert = REPORT_SINKS.try_emplace(filename);
+    ReportSink& sink = insert.first->second;
+    if (!insert.second) {
+        return sink;
+    }
+    auto format = STATS_FORMATS.find(STATS_FORMAT);
+    if (format == STATS_FORMATS.end()) {
+        std::cerr << "Unknown stats format " << STATS_FORMAT << ", using tsv" << std::endl;
+        format = STATS_FORMATS.find("tsv");
+    }
+    sink.statsFormat = format->second();
+    std::ios_base::openmode mode = std::ofstream::out | (truncate ? std::ofstream::trunc : std::ofstream::app);
+    sink.eteLogs.open(filename + "_flow_performance_measurements.log", mode);
+    sink.stats.open(filename + "_stats.dat", mode);
+    if (truncate) {
+        sink.statsFormat->writeHeader(sink.stats.file);
+    }
+    Simulator::ScheduleDestroy(&closeReportSink, filename);
+    return sink;
+}
 
-    XMLElement* nodeIdElement2 = ntnXmlFile.NewElement("node-id");
-    nodeIdElement2->InsertEndChild(ntnXmlFile.NewText(std::to_string(maxDelayIndex.second).c_str()));
-    nodePairElement->InsertEndChild(nodeIdElement2);
-    worstLinkElement->InsertEndChild(nodePairElement);
-     
-    worstLinksElement->InsertEndChild(worstLinkElement);
+// Network-wide KPIs of a report, averaged over every flow of the monitor (the flows
+// without packets count as 0)
+struct FlowKpis {
+    double averageThroughput = 0; // Mbps
+    double averageDelay = 0; // s
+    double averageJitter = 0; // s
+    double medianDelay = 0; // s, median of the mean delays of the flows
+};
 
-    ntnXmlFile.SaveFile(node_to_node_doc_path.c_str());
+// Sum of a column with four independent accumulators, so the additions don't wait on
+// each other and the compiler can keep them in one vector register
+double sumColumn(const double* values, size_t n) {
+    double lanes[4] = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        lanes[0] += values[i];
+        lanes[1] += values[i + 1];
+        lanes[2] += values[i + 2];
+        lanes[3] += values[i + 3];
+    }
+    for (; i < n; i++) {
+        lanes[i % 4] += values[i];
+    }
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Computes the KPIs from the hot counters of a monitor over rxDuration seconds. Every
+// loop is a branch-free pass over contiguous columns, and the median is a linear-time
+// selection, so a report costs O(flows). meanDelays and meanJitters are scratch space,
+// reused between the reports
+FlowKpis computeFlowKpis(const FlowMonitor::HotCounters& counters, double rxDuration,
+                         std::vector<double>& meanDelays, std::vector<double>& meanJitters) {
+    FlowKpis kpis;
+    size_t flows = counters.flowId.size();
+    if (flows == 0) {
+        return kpis;
+    }
+    meanDelays.resize(flows);
+    meanJitters.resize(flows);
+    const uint64_t* rxBytes = counters.rxBytes.data();
+    const uint32_t* rxPackets = counters.rxPackets.data();
+    const int64_t* delaySum = counters.delaySum.data();
+    const int64_t* jitterSum = counters.jitterSum.data();
+    double* delays = meanDelays.data();
+    double* jitters = meanJitters.data();
+
+    uint64_t totalRxBytes = 0;
+    for (size_t i = 0; i < flows; i++) {
+        totalRxBytes += rxBytes[i];
+    }
+    for (size_t i = 0; i < flows; i++) {
+        // The sums of a flow without packets are 0, so dividing by 1 gives it a 0 mean
+        double packets = std::max<uint32_t>(rxPackets[i], 1);
+        delays[i] = delaySum[i] * 1e-9 / packets;
+        jitters[i] = jitterSum[i] * 1e-9 / packets;
+    }
 
-    return std::make_pair(maxDelayIndex.first,maxDelayIndex.second);
+    kpis.averageThroughput = totalRxBytes * 8.0 / rxDuration / 1000 / 1000 / flows;
+    kpis.averageDelay = sumColumn(delays, flows) / flows;
+    kpis.averageJitter = sumColumn(jitters, flows) / flows;
+    std::nth_element(meanDelays.begin(), meanDelays.begin() + flows / 2, meanDelays.end());
+    kpis.medianDelay = meanDelays[flows / 2];
+    return kpis;
 }
-void nodeToNodeTriggerVoidWrapper(Ptr<FlowMonitor> monitor, std::string node_to_node_doc_path) {
-    nodeToNodeTrigger(monitor,node_to_node_doc_path);
+
+// Network-wide KPIs of a scenario configuration in a previous campaign, averaged over
+// the reports of its _stats.dat_avg.csv
+struct ScenarioBaseline {
+    float throughput; // Mbps
+    float delay; // s
+    float jitter; // s
+    uint32_t reports;
+};
+// (trafficTypeConf, direction, useUdp, uesPerGnb), e.g. ("NGMN VIDEO", "DL", true, 10)
+typedef std::tuple<std::string, std::string, bool, uint16_t> BaselineKey;
+// Baselines of every configuration found by loadBaselineStore()
+std::map<BaselineKey, ScenarioBaseline> BASELINE_STORE;
+
+// Loads every <simTag>_simTime-..._stats.dat_avg.csv of a directory into BASELINE_STORE.
+// Their rows are the average delay (ms), throughput (Mbps) and jitter (ms) of a report.
+// Returns the number of baselines loaded
+uint32_t loadBaselineStore(const std::string& directory) {
+    static const std::regex name(".*_trafficTypeConf-(.+)_direction-([A-Z]+)_.*_useUdp-([01])_uesPerGnb-([0-9]+)_stats\\.dat_avg\\.csv");
+    std::error_code error;
+    std::filesystem::directory_iterator files(directory, error);
+    if (error) {
+        std::cerr << "Can't open baseline directory " << directory << std::endl;
+        return 0;
+    }
+    uint32_t loaded = 0;
+    for (const std::filesystem::directory_entry& file : files) {
+        std::string fileName = file.path().filename().string();
+        std::smatch match;
+        if (!std::regex_match(fileName, match, name)) {
+            continue;
+        }
+        std::ifstream csv(file.path());
+        std::string line;
+        std::getline(csv, line); // avgDelay,avgThroughput,avgJitter
+        double delaySum = 0, throughputSum = 0, jitterSum = 0;
+        uint32_t reports = 0;
+        while (std::getline(csv, line)) {
+            double delay, throughput, jitter;
+            if (std::sscanf(line.c_str(), "%lf,%lf,%lf", &delay, &throughput, &jitter) != 3) {
+                continue;
+            }
+            delaySum += delay;
+            throughputSum += throughput;
+            jitterSum += jitter;
+            reports++;
+        }
+        if (reports == 0) {
+            continue;
+        }
+        BaselineKey key(match[1], match[2], match[3] == "1", std::stoul(match[4]));
+        BASELINE_STORE[key] = ScenarioBaseline{float(throughputSum / reports), float(delaySum / reports / 1000),
+                                               float(jitterSum / reports / 1000), reports};
+        loaded++;
+    }
+    return loaded;
 }
 
-void reportFlowStats(Ptr<FlowMonitor> monitor,Ptr<Ipv4FlowClassifier> classifier,std::string filename, Time lastCalled,Time simTime, TrackedStats thresholds){
-    // File for keeping the node-to-node logs
-    XMLDocument ntnXmlFile; 
-    std::ios_base::openmode open_file_flags;
-    std::string flow_performance_measurements_path = filename +"_flow_performance_measurements.log";
-    std::string node_to_node_doc_path = filename + "_node_to_node_delays.xml";
-    std::string stats_file_path = filename +"_stats.dat";
+// Baseline of a configuration, nullptr if none was loaded
+const ScenarioBaseline* findBaseline(const std::string& trafficTypeConf, const std::string& direction, bool useUdp, uint16_t uesPerGnb) {
+    auto baseline = BASELINE_STORE.find(BaselineKey(trafficTypeConf, direction, useUdp, uesPerGnb));
+    return baseline == BASELINE_STORE.end() ? nullptr : &baseline->second;
+}
+
+// The flow reports of a monitor, measured at the cadence of a MeasurementScheduler
+struct ReportSession {
+    Ptr<FlowMonitor> monitor;
+    Ptr<Ipv4FlowClassifier> classifier;
+    Ptr<Ipv6FlowClassifier> classifier6; // Found by the first report, if the monitor has one
+    Ptr<MeasurementScheduler> scheduler;
+    uint32_t classId;
+    TrackedStats thresholds; // Baseline of the flows, loaded from a previous campaign or taken by the first report
+    bool baselineLoaded = false;
+    std::vector<Ptr<TcpRttFlowProbe>> rttProbes; // Found by the first report
+    std::vector<Ptr<NrFlowProbe>> nrProbes; // Found by the first report
+    std::vector<double> meanDelays, meanJitters; // Reused by the reports, so they don't allocate them
+    Ptr<FlowAnomalyDetector> detector; // Baselines of every flow
+    FlowReport report; // Filled by every report, reusing its buffers
+};
+// Sessions by file name prefix
+std::map<std::string, ReportSession> REPORT_SESSIONS;
+
+void closeReportSession(std::string filename) {
+    REPORT_SESSIONS.erase(filename);
+}
+
+// Copies the flows of the monitor into a report, with the measurements of the active
+// ones, and updates their baselines in the session's detector
+void snapshotFlowReport(ReportSession& session, FlowReport& report) {
+    // Read in place: nothing changes the stats until the end of the report
+    const FlowMonitor::FlowStatsContainer& stats = session.monitor->GetFlowStats();
+    report.flows.resize(stats.size());
+    report.anomalousFlows = 0;
+    size_t index = 0;
+    for (const auto& [flowId, flowStats] : stats) {
+        FlowReportRow& flow = report.flows[index++];
+        flow.flowId = flowId;
+        flow.measurements = TrackedStats();
+        flow.active = !IsFlowStatsEmpty(flowId, flowStats);
+        if (!flow.active) {
+            continue;
+        }
+        // The classifiers share the FlowIds of the monitor, so a flow is in one of them
+        if (const Ipv4FlowClassifier::FiveTuple* tuple = session.classifier->PeekFlow(flowId)) {
+            flow.key = *tuple;
+        } else if (const Ipv6FlowClassifier::FiveTuple* tuple6 = session.classifier6 ? session.classifier6->PeekFlow(flowId) : nullptr) {
+            flow.key = *tuple6;
+        } else {
+            std::cerr << "Flow " << flowId << " is in no classifier of the report, it is reported as inactive" << std::endl;
+            flow.active = false;
+            continue;
+        }
+        flow.txBytes = flowStats.txBytes;
+        flow.rxBytes = flowStats.rxBytes;
+        flow.txPackets = flowStats.txPackets;
+        flow.rxPackets = flowStats.rxPackets;
+        flow.reverseFlowId = session.classifier->GetReverseFlow(flowId);
+        flow.rtt.reset();
+        const TcpRttFlowProbe::RttStats* rtt = findRttStats(session.rttProbes, flowId);
+        if (rtt) {
+            const TcpRttFlowProbe::RttStats& r = *rtt;
+            flow.rtt = RttSummary{r.samples, r.rttSum / r.samples, r.minRtt, r.maxRtt,
+                                  histogramPercentile(r.rttHistogram, r.samples, 0.5),
+                                  histogramPercentile(r.rttHistogram, r.samples, 0.95)};
+        }
+        flow.radio.reset();
+        NrFlowProbe::FlowRadioStats radio;
+        for (const Ptr<NrFlowProbe>& nrProbe : session.nrProbes) {
+            const std::map<FlowId, NrFlowProbe::FlowRadioStats>& probeStats = nrProbe->GetFlowRadioStats();
+            auto stats = probeStats.find(flowId);
+            if (stats != probeStats.end()) {
+                radio.bufferWaitSum += stats->second.bufferWaitSum;
+                radio.airDelaySum += stats->second.airDelaySum;
+                radio.packets += stats->second.packets;
+            }
+        }
+        if (radio.packets > 0) {
+            flow.radio = RadioSummary{radio.packets, radio.bufferWaitSum / radio.packets, radio.airDelaySum / radio.packets};
+        }
+
+        TrackedStats& measurements = flow.measurements;
+        measurements.lastPacketDelay = flowStats.lastDelay;
+        if (flowStats.rxPackets > 0) {
+            // Measure the duration of the flow from receiver's perspective
+            float rxDuration = report.duration;
+
+            // In Mbps
+            measurements.rxDuration = rxDuration;
+            measurements.throughput = flowStats.rxBytes * 8.0 / rxDuration / 1000 / 1000;
+            measurements.meanDelay = Seconds(flowStats.delaySum.GetSeconds() / flowStats.rxPackets);
+            measurements.meanJitter = Seconds(flowStats.jitterSum.GetSeconds() / flowStats.rxPackets);
+        }
+
+        // Each flow against its own baseline, so a single degraded flow isn't averaged away
+        FlowAnomalyDetector::Result anomaly = flowStats.rxPackets > 0
+            ? session.detector->Update(flowId, measurements.throughput, measurements.meanDelay, measurements.meanJitter)
+            : session.detector->Update(flowId, measurements.throughput);
+        flow.anomaly.reset();
+        if (anomaly.anomalous) {
+            report.anomalousFlows++;
+            flow.anomaly = anomaly;
+        }
+    }
+}
 
-    if (lastCalled == MilliSeconds(400)) {
+// Reports the flows of a session over the period since lastCalled, and tells its
+// scheduler whether they are degraded. The report only takes the KPIs and decides;
+// with ANALYSIS_THREADS, its files are written in the background
+bool reportFlowStats(std::string filename, uint32_t classId, Time lastCalled){
+    ReportSession& session = REPORT_SESSIONS.at(filename);
+    Ptr<FlowMonitor> monitor = session.monitor;
+    Ptr<MeasurementScheduler> scheduler = session.scheduler;
+    TrackedStats& thresholds = session.thresholds;
+    std::string node_to_node_doc_path = filename + "_node_to_node_delays.xml";
+    bool firstReport = scheduler->GetMeasurements(classId) == 0;
+    if (firstReport && REPORT_SINKS.find(filename) == REPORT_SINKS.end()) {
         // We clean any previous measures_doc that could be present
+        XMLDocument ntnXmlFile;
         ntnXmlFile.SaveFile( node_to_node_doc_path.c_str() );
-        open_file_flags = std::ofstream::out | std::ofstream::trunc;
-    } else {
-        // We open a file to save the flow performance metrics
-        open_file_flags = std::ofstream::out | std::ofstream::app ;
-    }
-    // File for keeping the end-to-end logs
-    std::ofstream eteLogsFile;
-    // File for keeping stats to plot later
-    std::ofstream statsFile;
-    eteLogsFile.open(flow_performance_measurements_path.c_str(),open_file_flags);
-    statsFile.open(stats_file_path.c_str(),open_file_flags);
-    if (!eteLogsFile.is_open())
-    {
-        std::cerr << "Can't open file " << flow_performance_measurements_path << std::endl;
-    }
-    if (!statsFile.is_open())
-    {
-        std::cerr << "Can't open file " << stats_file_path << std::endl;
-    }
-    eteLogsFile.setf(std::ios_base::fixed);
-    statsFile.setf(std::ios_base::fixed);
+    }
 
     monitor->CheckForLostPackets(MilliSeconds(300));
 
-    TrackedStats measurements(0,0, Seconds(0), Seconds(0), Seconds(0), 0, Seconds(0),Seconds(0),Seconds(0));
-    double averageFlowThroughput = 0.0;
-    double averageFlowDelay = 0.0;
-    double averageMeanJitter = 0.0;
-    FlowMonitor::FlowStatsContainer stats = monitor->GetFlowStats();
-    std::vector<double> delayValues(stats.size());
-    uint64_t cont = 0;
-
-    eteLogsFile << "Report flow stats " << Simulator::Now().As(Time::MS) << ", Current measuring time " << NEXT_MEASURE_IN.As(Time::MS) << std::endl;
-    statsFile << Simulator::Now().GetMilliSeconds();
-
-    for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator i = stats.begin();
-         i != stats.end();
-         ++i)
-    {
-        if (!IsFlowStatsEmpty(i->first,i->second)) {
-            Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(i->first);
-            std::stringstream protoStream;
-            protoStream << (uint16_t)t.protocol;
-            if (t.protocol == 6)
-            {
-                protoStream.str("TCP");
-            }
-            if (t.protocol == 17)
-            {
-                protoStream.str("UDP");
-            }
-            eteLogsFile << "\tFlow " << i->first << " (" << t.sourceAddress << ":" << t.sourcePort << " -> "
-                    << t.destinationAddress << ":" << t.destinationPort << ") proto " << protoStream.str() << "\n";
-            eteLogsFile << "\t\tTx Packets: " << i->second.txPackets << "\n";
-            eteLogsFile << "\t\tTx Bytes:   " << i->second.txBytes << "\n";
-            eteLogsFile << "\t\tTxOffered:  " << i->second.txBytes * 8.0 / (Simulator::Now() - lastCalled).GetSeconds() / 1000.0 / 1000.0 << " Mbps\n";
-            eteLogsFile << "\t\tRx Packets: " << i->second.rxPackets << "\n";
-            eteLogsFile << "\t\tRx Bytes:   " << i->second.rxBytes << "\n";
-
-            // We initialize througput, meanDelay and meanJitter with -
-            measurements.rxDuration = 0;
-            measurements.throughput = 0;
-            measurements.meanDelay = Seconds(0);
-            measurements.meanJitter = Seconds(0);
-
-            
-            measurements.lastPacketDelay = i->second.lastDelay;
-            if (i->second.rxPackets > 0) {
-                // Measure the duration of the flow from receiver's perspective
-                float rxDuration = (Simulator::Now() - lastCalled).GetSeconds();
-
-                averageFlowThroughput += i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000;
-                averageFlowDelay += i->second.delaySum.GetSeconds() / i->second.rxPackets;
-                averageMeanJitter += i->second.jitterSum.GetSeconds() / i->second.rxPackets;
-                delayValues[cont] = i->second.delaySum.GetSeconds() / i->second.rxPackets;
-                cont++;
-                // In Mbps
-                measurements.rxDuration = rxDuration;
-                measurements.throughput = i->second.rxBytes * 8.0 / rxDuration / 1000 / 1000;
-                measurements.meanDelay = Seconds( i->second.delaySum.GetSeconds() / i->second.rxPackets);
-                measurements.meanJitter = Seconds(i->second.jitterSum.GetSeconds() / i->second.rxPackets);
-            }
-                
-            eteLogsFile << "\t\tRxDuration: " << measurements.rxDuration << " s\n";
-            eteLogsFile << "\t\tThroughput: " << measurements.throughput << " Mbps\n";
-            eteLogsFile << "\t\tMean delay: "<< measurements.meanDelay.As(Time::MS) << " \n";
-            eteLogsFile << "\t\tLast packet delay: " << measurements.lastPacketDelay.As(Time::MS) << " \n";
-            eteLogsFile << "\t\tMean jitter: " << measurements.meanJitter.As(Time::MS) << "\n";
-
-            statsFile << "\t" << measurements.throughput << "\t" << (measurements.meanDelay.GetDouble()/1000000) << "\t" << (measurements.meanJitter.GetDouble()/1000000);
-
-            // if( !(lastCalled == MilliSeconds(400)) && (
-            //     measurements.throughput < thresholds.throughput || 
-            //     measurements.meanDelay > thresholds.meanDelay)
-            // ){
-            //     eteLogsFile << "\n\t Flow "<< i->first <<" surpassing threshold " << "\n";
-            // }
-        } else {
-            // Fill the position of the non active flows
-            statsFile << "\t0.000000\t0.000000\t0.000000";
-        }
-    
+    if (firstReport) {
+        session.rttProbes = findRttProbes(monitor);
+        session.nrProbes = findNrProbes(monitor);
+        session.classifier6 = findIpv6Classifier(monitor);
     }
-    std::sort(delayValues.begin(), delayValues.end());
-    double delayValuesMedian = delayValues[stats.size() / 2];
 
-    // These metrics are global to all the flows
-    measurements.flowsAverageThroughput = averageFlowThroughput / stats.size();
-    measurements.flowsAverageDelay= Seconds(averageFlowDelay / stats.size());
-    measurements.delayValuesMedian = Seconds(delayValuesMedian);
-    measurements.flowsAverageMeanJitter = Seconds(averageMeanJitter / stats.size());
+    FlowReport& report = session.report;
+    // The files stay open between the reports, and are written when their buffers fill up
+    // or every REPORT_FLUSH_INTERVAL
+    report.sink = &getReportSink(filename, firstReport);
+    report.now = Simulator::Now().GetNanoSeconds();
+    report.interval = scheduler->GetInterval(classId);
+    report.duration = (Simulator::Now() - lastCalled).GetSeconds();
+    // Node-to-node triggers analysed in the background since the last report
+    report.nodeToNode.clear();
+    NODE_TO_NODE_PIPELINE.drain(node_to_node_doc_path, report.nodeToNode);
+    snapshotFlowReport(session, report);
 
-    eteLogsFile << "\n\n\tAverage flow throughput: " << measurements.flowsAverageThroughput << " Mbps" << std::endl;
-    eteLogsFile << "\tAverage flow delay: " << measurements.flowsAverageDelay.As(Time::MS) << std::endl;
-    eteLogsFile << "\tAverage flow jitter: " << measurements.flowsAverageMeanJitter.As(Time::MS) << std::endl;
-    eteLogsFile << "\tMedian flow delay: " << measurements.delayValuesMedian.As(Time::MS) << std::endl << std::endl;
-    statsFile << "\t" << (measurements.flowsAverageDelay.GetDouble() / 1000000) << "\t" << measurements.flowsAverageThroughput << "\t" << (measurements.flowsAverageMeanJitter.GetDouble()/1000000) << std::endl;
+    // These metrics are global to all the flows, computed from the monitor's hot counters
+    FlowKpis kpis = computeFlowKpis(monitor->GetHotCounters(), report.duration,
+                                    session.meanDelays, session.meanJitters);
+    TrackedStats& measurements = report.totals;
+    measurements.flowsAverageThroughput = kpis.averageThroughput;
+    measurements.flowsAverageDelay = Seconds(kpis.averageDelay);
+    measurements.delayValuesMedian = Seconds(kpis.medianDelay);
+    measurements.flowsAverageMeanJitter = Seconds(kpis.averageJitter);
 
     bool triggerFlag = false;
     std::optional<std::pair<int64_t,int64_t>> worstPerformingLink;
-    // lastCalled has to be compared to the time when apps started
-    if (!(lastCalled == MilliSeconds(400))) {
+    // Without a loaded baseline, the first report only takes it
+    report.decided = !firstReport || session.baselineLoaded;
+    if (report.decided) {
         // Now we check wheter or not we need to call a node-to-node mearurment
-        if( (thresholds.flowsAverageThroughput - measurements.flowsAverageThroughput) >= (thresholds.flowsAverageThroughput * RELATIVE_THRESHOLD_THROUGHPUT_ACCEPTANCE)){ // If the throughput is less than 90% of what's expected
-
-            triggerFlag = true;
-            NEXT_MEASURE_IN = NETWORK_NOT_OK_MEASURING_TIME; 
-            eteLogsFile << "\tAverage throughput surpassing threshold: " << (measurements.flowsAverageThroughput) << " < " << (thresholds.flowsAverageThroughput * RELATIVE_THRESHOLD_THROUGHPUT_ACCEPTANCE) << std::endl;
+        report.throughputLimit = thresholds.flowsAverageThroughput * scheduler->GetRelativeThroughputThreshold();
+        report.delayLimit = thresholds.flowsAverageDelay * scheduler->GetRelativeDelayThreshold();
+        report.jitterLimit = thresholds.flowsAverageMeanJitter * scheduler->GetRelativeJitterThreshold();
+        // If the throughput is less than 90% of what's expected
+        report.throughputDegraded = (thresholds.flowsAverageThroughput - measurements.flowsAverageThroughput) >= report.throughputLimit;
+        // If the meanDelay or the meanJitter surpass the expected value by 10%
+        report.delayDegraded = (measurements.flowsAverageDelay - thresholds.flowsAverageDelay) >= report.delayLimit;
+        report.jitterDegraded = (measurements.flowsAverageMeanJitter - thresholds.flowsAverageMeanJitter) >= report.jitterLimit;
+        triggerFlag = report.throughputDegraded || report.delayDegraded || report.jitterDegraded || report.anomalousFlows > 0;
+        if (triggerFlag) {
             worstPerformingLink = nodeToNodeTrigger(monitor,node_to_node_doc_path);
         }
-        if( (measurements.flowsAverageDelay - thresholds.flowsAverageDelay) >= (thresholds.flowsAverageDelay * RELATIVE_THRESHOLD_DELAY_ACCEPTANCE)) {  // If the meanDelay surpasses the expected value by 10%
-            NEXT_MEASURE_IN = NETWORK_NOT_OK_MEASURING_TIME; 
-            eteLogsFile << "\tAverage delay surpassing Delay: " << (measurements.flowsAverageDelay ) <<  " > " <<(thresholds.flowsAverageDelay * RELATIVE_THRESHOLD_DELAY_ACCEPTANCE) << std::endl;
-            if (!triggerFlag) {
-                worstPerformingLink = nodeToNodeTrigger(monitor,node_to_node_doc_path);
-            }
-            triggerFlag = true;
-        }
-        if( (measurements.flowsAverageMeanJitter - thresholds.flowsAverageMeanJitter) >= (thresholds.flowsAverageMeanJitter*RELATIVE_THRESHOLD_JITTER_ACCEPTANCE) ){ // If the meanJitter surpasses the expected value by 10%
-            NEXT_MEASURE_IN = NETWORK_NOT_OK_MEASURING_TIME; 
-            eteLogsFile << "\tAverage Jitter surpassing threshold" << (measurements.flowsAverageMeanJitter ) << " > " << (thresholds.flowsAverageMeanJitter*RELATIVE_THRESHOLD_JITTER_ACCEPTANCE) << std::endl;
-            if (!triggerFlag) {
-                worstPerformingLink = nodeToNodeTrigger(monitor,node_to_node_doc_path);
-            }
-            triggerFlag = true;
-        }
-        if (!triggerFlag) {
-            NEXT_MEASURE_IN = NETWORK_OK_MEASURING_TIME;
-            eteLogsFile << "\n\t Perforance under threshold(good)" << std::endl;
-        } else if (worstPerformingLink.has_value()) {
-            eteLogsFile << "\tWorst performing link: ("<< worstPerformingLink.value().first << "," << worstPerformingLink.value().second << ")" << std::endl;
-        }
     } else {
         // Initialize the thresholds with the first measurment
         thresholds.flowsAverageThroughput =  measurements.flowsAverageThroughput;
         thresholds.flowsAverageDelay =  measurements.flowsAverageDelay;
         thresholds.flowsAverageMeanJitter =  measurements.flowsAverageMeanJitter;
     }
-    eteLogsFile.close();
-    statsFile.close();
+    report.worstLink = worstPerformingLink;
+
+    if (ANALYSIS_THREADS > 0) {
+        REPORT_WRITER.submit(report);
+    } else {
+        writeFlowReport(report);
+    }
 
     // We reset all stats to ensure that we're not reusing them for the next iteration
     monitor->ResetAllStats();
+    return triggerFlag;
+}
 
-    // If there isn't time for next measurment...we stop
-    if ((simTime - Simulator::Now()) < NEXT_MEASURE_IN){
-        std::cout << Simulator::Now().As(Time::MS) << std::endl;
-        std::cout << (simTime - Simulator::Now()).As(Time::MS)<< std::endl;
-        Simulator::Stop(simTime - Simulator::Now());
-    } else {
-        Simulator::Schedule(NEXT_MEASURE_IN,&reportFlowStats,monitor,classifier,filename,Simulator::Now(),simTime,thresholds);
+// Releases the baseline of a flow evicted by the monitor of a session
+void forgetEvictedFlow(Ptr<FlowAnomalyDetector> detector, const FlowMonitor::FlowEvent& event) {
+    detector->ForgetFlow(event.flowId);
+}
+
+// Starts the reports of a monitor into the files prefixed by filename. The first report
+// comes a HealthyInterval of the scheduler after start. It takes the baseline of the flows,
+// unless a baseline of a previous campaign is given
+void startFlowReports(Ptr<MeasurementScheduler> scheduler, Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, std::string filename, Time start, const ScenarioBaseline* baseline = nullptr) {
+    ReportSession& session = REPORT_SESSIONS[filename];
+    session.monitor = monitor;
+    session.classifier = classifier;
+    session.scheduler = scheduler;
+    if (baseline) {
+        // The degradations are detected from the first report on
+        session.thresholds.flowsAverageThroughput = baseline->throughput;
+        session.thresholds.flowsAverageDelay = Seconds(baseline->delay);
+        session.thresholds.flowsAverageMeanJitter = Seconds(baseline->jitter);
+        session.baselineLoaded = true;
     }
+    session.detector = CreateObject<FlowAnomalyDetector>();
+    monitor->TraceConnectWithoutContext("FlowEvicted", MakeBoundCallback(&forgetEvictedFlow, session.detector));
+    session.classId = scheduler->AddClass(MakeBoundCallback(&reportFlowStats, filename), start);
+    Simulator::ScheduleDestroy(&closeReportSession, filename);
 }
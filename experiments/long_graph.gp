@@ -0,0 +1,16 @@
+set title "Network Performance Over Time"
+set xlabel "Time (s)"
+set ylabel "Performance value"
+set key outside
+set grid
+set datafile separator "\t"
+
+# test_stats.dat written with --statsFormat=long: the records are selected by type,
+# and the columns are the same whatever the number of flows
+set style line 1 lc rgb "#FF0000" lw 2 dashtype solid  # avg.Throughput (red)
+set style line 2 lc rgb "#0000FF" lw 2 dashtype solid  # avg.meanDelay (blue)
+set style line 4 lc rgb "#80008080" pt 7 ps 0.5  # meanDelay of every flow (purple, semi-transparent)
+
+plot "< grep '^A' test_stats.dat" using ($2/1000):3 with lines ls 1 title 'avg.Throughput', \
+     "< grep '^A' test_stats.dat" using ($2/1000):4 with lines ls 2 title 'avg.meanDelay', \
+     "< grep '^S' test_stats.dat" using ($2/1000):5 with points ls 4 notitle
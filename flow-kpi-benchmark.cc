@@ -0,0 +1,123 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Measures the wall-clock cost of the network-wide KPIs of a report (average
+// throughput, delay and jitter, median delay) as the number of flows grows:
+// computeFlowKpis over the hot counters of the monitor, against the former
+// walk of the FlowStatsContainer with a sort for the median.  The cost per
+// flow of computeFlowKpis should stay flat up to maxFlows.
+//
+// No simulation is run: the counters are synthetic.
+//
+// ./ns3 run "flow-kpi-benchmark --maxFlows=100000 --reports=100"
+
+#include "big-brother-tracker.cc"
+
+#include <chrono>
+#include <iostream>
+
+NS_LOG_COMPONENT_DEFINE("FlowKpiBenchmark");
+
+// Returns the seconds elapsed since start
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Computes the KPIs as reportFlowStats did before the hot counters: one pass over
+// the map nodes, then a sort of the mean delays for the median
+FlowKpis mapFlowKpis(const FlowMonitor::FlowStatsContainer& stats, double rxDuration, std::vector<double>& delayValues)
+{
+    FlowKpis kpis;
+    delayValues.assign(stats.size(), 0.0);
+    uint64_t cont = 0;
+    for (const auto& [flowId, flowStats] : stats) {
+        if (!IsFlowStatsEmpty(flowId, flowStats) && flowStats.rxPackets > 0) {
+            kpis.averageThroughput += flowStats.rxBytes * 8.0 / rxDuration / 1000 / 1000;
+            kpis.averageDelay += flowStats.delaySum.GetSeconds() / flowStats.rxPackets;
+            kpis.averageJitter += flowStats.jitterSum.GetSeconds() / flowStats.rxPackets;
+            delayValues[cont] = flowStats.delaySum.GetSeconds() / flowStats.rxPackets;
+            cont++;
+        }
+    }
+    std::sort(delayValues.begin(), delayValues.end());
+    kpis.medianDelay = delayValues[stats.size() / 2];
+    kpis.averageThroughput /= stats.size();
+    kpis.averageDelay /= stats.size();
+    kpis.averageJitter /= stats.size();
+    return kpis;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t maxFlows = 100000;
+    uint32_t reports = 100;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("maxFlows", "Largest number of flows, from 100 up by factors of 10", maxFlows);
+    cmd.AddValue("reports", "Number of reports timed at every size", reports);
+    cmd.Parse(argc, argv);
+
+    const double rxDuration = 0.5;
+    std::cout << "flows\thot counters (ns/flow)\tflow stats map (ns/flow)" << std::endl;
+    for (uint32_t flows = 100; flows <= maxFlows; flows *= 10) {
+        // Every tenth flow has not received anything yet
+        FlowMonitor::HotCounters counters;
+        FlowMonitor::FlowStatsContainer stats;
+        for (uint32_t i = 0; i < flows; i++) {
+            uint32_t packets = i % 10 == 0 ? 0 : 100 + i % 97;
+            int64_t delay = 1000000 + (i * 7919) % 5000000; // ns, shuffled
+            FlowMonitor::FlowStats& flowStats = stats[i + 1];
+            flowStats.txPackets = packets;
+            flowStats.txBytes = packets * 1400;
+            flowStats.rxPackets = packets;
+            flowStats.rxBytes = packets * 1400;
+            flowStats.delaySum = NanoSeconds(delay * packets);
+            flowStats.jitterSum = NanoSeconds(delay / 10 * packets);
+            flowStats.lastDelay = NanoSeconds(packets ? delay : 0);
+            counters.flowId.push_back(i + 1);
+            counters.rxBytes.push_back(flowStats.rxBytes);
+            counters.rxPackets.push_back(flowStats.rxPackets);
+            counters.delaySum.push_back(flowStats.delaySum.GetNanoSeconds());
+            counters.jitterSum.push_back(flowStats.jitterSum.GetNanoSeconds());
+            counters.lastDelay.push_back(flowStats.lastDelay.GetNanoSeconds());
+        }
+
+        std::vector<double> meanDelays, meanJitters;
+        double difference = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t r = 0; r < reports; r++) {
+            FlowKpis kpis = computeFlowKpis(counters, rxDuration, meanDelays, meanJitters);
+            difference += kpis.averageThroughput + kpis.averageDelay + kpis.medianDelay;
+        }
+        double hotTime = secondsSince(start);
+
+        std::vector<double> delayValues;
+        start = std::chrono::steady_clock::now();
+        for (uint32_t r = 0; r < reports; r++) {
+            FlowKpis kpis = mapFlowKpis(stats, rxDuration, delayValues);
+            difference -= kpis.averageThroughput + kpis.averageDelay + kpis.medianDelay;
+        }
+        double mapTime = secondsSince(start);
+
+        // Both compute the same KPIs, up to rounding
+        std::cout << flows << "\t" << hotTime * 1e9 / reports / flows << "\t" << mapTime * 1e9 / reports / flows
+                  << "\t(difference " << difference / reports << ")" << std::endl;
+    }
+
+    return 0;
+}
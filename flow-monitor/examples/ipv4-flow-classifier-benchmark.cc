@@ -0,0 +1,125 @@
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+// Measures the wall-clock cost of the Ipv4FlowClassifier operations used by
+// the reports: classifying packets, FindFlow() for every flow (as done by
+// reportFlowStats at every interval) and the GetAllFlows() bulk accessor.
+//
+// No simulation is run: packets are classified directly, as the first
+// Ipv4FlowProbe on their path would do.
+//
+// ./ns3 run "ipv4-flow-classifier-benchmark --nFlows=10000 --reports=10"
+
+#include "ns3/core-module.h"
+#include "ns3/ipv4-flow-classifier.h"
+#include "ns3/network-module.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("Ipv4FlowClassifierBenchmark");
+
+/// \returns the seconds elapsed since start
+static double
+SecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nFlows = 10000;
+    uint32_t packetsPerFlow = 10;
+    uint32_t reports = 10;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("nFlows", "Number of distinct five-tuples", nFlows);
+    cmd.AddValue("packetsPerFlow", "Packets classified per flow", packetsPerFlow);
+    cmd.AddValue("reports", "Number of simulated reports looking up every flow", reports);
+    cmd.Parse(argc, argv);
+
+    Ptr<Ipv4FlowClassifier> classifier = Create<Ipv4FlowClassifier>();
+
+    // One UDP header worth of payload: the classifier reads the ports only
+    std::vector<Ptr<Packet>> payloads;
+    std::vector<Ipv4Header> headers;
+    payloads.reserve(nFlows);
+    headers.reserve(nFlows);
+    for (uint32_t i = 0; i < nFlows; i++)
+    {
+        uint16_t srcPort = 49153 + (i % 16000);
+        uint16_t dstPort = 1000 + (i / 16000);
+        uint8_t ports[8] = {static_cast<uint8_t>(srcPort >> 8),
+                            static_cast<uint8_t>(srcPort),
+                            static_cast<uint8_t>(dstPort >> 8),
+                            static_cast<uint8_t>(dstPort)};
+        payloads.push_back(Create<Packet>(ports, sizeof(ports)));
+
+        Ipv4Header header;
+        header.SetSource(Ipv4Address(0x07000002 + (i % 250)));
+        header.SetDestination(Ipv4Address("1.0.0.2"));
+        header.SetProtocol(17);
+        header.SetDscp(i % 2 ? Ipv4Header::DSCP_EF : Ipv4Header::DscpDefault);
+        headers.push_back(header);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    FlowId flowId;
+    FlowPacketId packetId;
+    for (uint32_t p = 0; p < packetsPerFlow; p++)
+    {
+        for (uint32_t i = 0; i < nFlows; i++)
+        {
+            classifier->Classify(headers[i], payloads[i], &flowId, &packetId);
+        }
+    }
+    double classifyTime = SecondsSince(start);
+
+    // reportFlowStats: one FindFlow() per flow in the stats container
+    start = std::chrono::steady_clock::now();
+    uint64_t checksum = 0;
+    for (uint32_t r = 0; r < reports; r++)
+    {
+        for (FlowId id = 1; id <= flowId; id++)
+        {
+            checksum += classifier->FindFlow(id).sourcePort;
+        }
+    }
+    double findTime = SecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < reports; r++)
+    {
+        for (const auto& [id, tuple] : classifier->GetAllFlows())
+        {
+            checksum += tuple.sourcePort;
+        }
+    }
+    double bulkTime = SecondsSince(start);
+
+    std::cout << "flows: " << flowId << ", packets: " << nFlows * packetsPerFlow << std::endl;
+    std::cout << "Classify:    " << classifyTime * 1e9 / (nFlows * packetsPerFlow)
+              << " ns/packet" << std::endl;
+    std::cout << "FindFlow:    " << findTime * 1e3 / reports << " ms/report ("
+              << findTime * 1e9 / (static_cast<double>(reports) * flowId) << " ns/flow)"
+              << std::endl;
+    std::cout << "GetAllFlows: " << bulkTime * 1e3 / reports << " ms/report" << std::endl;
+    std::cout << "checksum: " << checksum << std::endl;
+
+    return 0;
+}
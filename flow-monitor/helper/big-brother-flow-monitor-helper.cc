@@ -19,15 +19,17 @@
 
 #include "flow-monitor-helper.h"
 
+#include "ns3/abort.h"
 #include "ns3/flow-monitor.h"
 #include "ns3/ipv4-flow-classifier.h"
 #include "ns3/big-brother-flow-probe.h"
 #include "ns3/ipv4-l3-protocol.h"
 #include "ns3/ipv6-flow-classifier.h"
-#include "ns3/ipv6-flow-probe.h"
 #include "ns3/ipv6-l3-protocol.h"
 #include "ns3/node-list.h"
 #include "ns3/node.h"
+#include "ns3/nr-flow-probe.h"
+#include "ns3/tcp-rtt-flow-probe.h"
 
 namespace ns3
 {
@@ -35,6 +37,7 @@ namespace ns3
 FlowMonitorHelper::FlowMonitorHelper()
 {
     m_monitorFactory.SetTypeId("ns3::FlowMonitor");
+    m_probeConfigFactory.SetTypeId("ns3::BigBrotherProbeConfig");
 }
 
 FlowMonitorHelper::~FlowMonitorHelper()
@@ -46,6 +49,7 @@ FlowMonitorHelper::~FlowMonitorHelper()
         m_flowClassifier4 = nullptr;
         m_flowClassifier6 = nullptr;
     }
+    m_probeConfig = nullptr;
 }
 
 void
@@ -54,20 +58,42 @@ FlowMonitorHelper::SetMonitorAttribute(std::string n1, const AttributeValue& v1)
     m_monitorFactory.Set(n1, v1);
 }
 
+void
+FlowMonitorHelper::SetProbeAttribute(std::string n1, const AttributeValue& v1)
+{
+    NS_ABORT_MSG_IF(m_probeConfig, "Probe attributes must be set before Install*");
+    m_probeConfigFactory.Set(n1, v1);
+}
+
+Ptr<BigBrotherProbeConfig>
+FlowMonitorHelper::GetProbeConfig()
+{
+    if (!m_probeConfig)
+    {
+        m_probeConfig = m_probeConfigFactory.Create<BigBrotherProbeConfig>();
+    }
+    return m_probeConfig;
+}
+
 Ptr<FlowMonitor>
 FlowMonitorHelper::GetMonitor()
 {
     if (!m_flowMonitor)
     {
         m_flowMonitor = m_monitorFactory.Create<FlowMonitor>();
-        m_flowClassifier4 = Create<Ipv4FlowClassifier>();
-        m_flowMonitor->AddFlowClassifier(m_flowClassifier4);
-        m_flowClassifier6 = Create<Ipv6FlowClassifier>();
-        m_flowMonitor->AddFlowClassifier(m_flowClassifier6);
+        m_flowMonitor->AddFlowClassifier(GetClassifier());
+        m_flowMonitor->AddFlowClassifier(GetClassifier6());
     }
     return m_flowMonitor;
 }
 
+void
+FlowMonitorHelper::SetClassifier(Ptr<Ipv4FlowClassifier> classifier)
+{
+    NS_ABORT_MSG_IF(m_flowMonitor, "SetClassifier must be called before Install*");
+    m_flowClassifier4 = classifier;
+}
+
 Ptr<FlowClassifier>
 FlowMonitorHelper::GetClassifier()
 {
@@ -92,19 +118,28 @@ Ptr<FlowMonitor>
 FlowMonitorHelper::Install(Ptr<Node> node)
 {
     Ptr<FlowMonitor> monitor = GetMonitor();
+    Ptr<BigBrotherProbeConfig> config = GetProbeConfig();
     Ptr<FlowClassifier> classifier = GetClassifier();
     Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
     if (ipv4)
     {
         Ptr<BigBrotherFlowProbe> probe =
-            Create<BigBrotherFlowProbe>(monitor, DynamicCast<Ipv4FlowClassifier>(classifier), node);
+            CreateBigBrotherFlowProbe(config->GetFeatures(),
+                                      monitor,
+                                      DynamicCast<Ipv4FlowClassifier>(classifier),
+                                      node);
+        probe->SetSamplingRate(config->GetSamplingRate());
     }
     Ptr<FlowClassifier> classifier6 = GetClassifier6();
     Ptr<Ipv6L3Protocol> ipv6 = node->GetObject<Ipv6L3Protocol>();
     if (ipv6)
     {
-        Ptr<Ipv6FlowProbe> probe6 =
-            Create<Ipv6FlowProbe>(monitor, DynamicCast<Ipv6FlowClassifier>(classifier6), node);
+        Ptr<Ipv6BigBrotherFlowProbe> probe6 =
+            CreateIpv6BigBrotherFlowProbe(config->GetFeatures(),
+                                          monitor,
+                                          DynamicCast<Ipv6FlowClassifier>(classifier6),
+                                          node);
+        probe6->SetSamplingRate(config->GetSamplingRate());
     }
     return m_flowMonitor;
 }
@@ -137,6 +172,29 @@ FlowMonitorHelper::InstallAll()
     return m_flowMonitor;
 }
 
+Ptr<FlowMonitor>
+FlowMonitorHelper::InstallNr(NodeContainer nodes)
+{
+    Ptr<FlowMonitor> monitor = GetMonitor();
+    for (auto i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        Create<NrFlowProbe>(monitor, *i);
+    }
+    return m_flowMonitor;
+}
+
+Ptr<FlowMonitor>
+FlowMonitorHelper::InstallRtt(NodeContainer nodes)
+{
+    Ptr<FlowMonitor> monitor = GetMonitor();
+    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(GetClassifier());
+    for (auto i = nodes.Begin(); i != nodes.End(); ++i)
+    {
+        Create<TcpRttFlowProbe>(monitor, classifier, *i);
+    }
+    return m_flowMonitor;
+}
+
 void
 FlowMonitorHelper::SerializeToXmlStream(std::ostream& os,
                                         uint16_t indent,
@@ -30,6 +30,7 @@ namespace ns3
 {
 
 class AttributeValue;
+class BigBrotherProbeConfig;
 class Ipv4FlowClassifier;
 class Ipv6FlowClassifier;
 
@@ -54,6 +55,19 @@ class FlowMonitorHelper
      */
     void SetMonitorAttribute(std::string n1, const AttributeValue& v1);
 
+    /**
+     * \brief Set an attribute for the to-be-created IPv4 and IPv6 big-brother probes
+     *
+     * The attributes are those of ns3::BigBrotherProbeConfig (ProbeFlowStats,
+     * PerHopRecording, DropTracking, InterfaceCounters, SamplingRate).  They
+     * select which BigBrotherProbeImpl instantiation is installed, so they
+     * must be set before calling Install*.
+     *
+     * \param n1 attribute name
+     * \param v1 attribute value
+     */
+    void SetProbeAttribute(std::string n1, const AttributeValue& v1);
+
     /**
      * \brief Enable flow monitoring on a set of nodes
      * \param nodes A NodeContainer holding the set of nodes to work with.
@@ -72,12 +86,41 @@ class FlowMonitorHelper
      */
     Ptr<FlowMonitor> InstallAll();
 
+    /**
+     * \brief Enable radio segment monitoring on NR nodes (UEs and gNBs)
+     *
+     * Creates an NrFlowProbe per node.  Packets are identified by the tag
+     * of the IPv4 probes, so Install* must also cover the flows' sources.
+     * \param nodes A NodeContainer holding the NR nodes
+     * \returns a pointer to the FlowMonitor object
+     */
+    Ptr<FlowMonitor> InstallNr(NodeContainer nodes);
+
+    /**
+     * \brief Enable passive TCP RTT estimation on a set of nodes
+     *
+     * Creates a TcpRttFlowProbe per node, pairing the two directions of
+     * each conversation through the IPv4 classifier.  Install* must also
+     * cover the flows' sources.
+     * \param nodes A NodeContainer holding the nodes, e.g., the endpoints
+     * \returns a pointer to the FlowMonitor object
+     */
+    Ptr<FlowMonitor> InstallRtt(NodeContainer nodes);
+
     /**
      * \brief Retrieve the FlowMonitor object created by the Install* methods
      * \returns a pointer to the FlowMonitor object
      */
     Ptr<FlowMonitor> GetMonitor();
 
+    /**
+     * \brief Use a custom IPv4 classifier, e.g., an Ipv4AggregateFlowClassifier
+     *
+     * Must be called before Install*; the default is an Ipv4FlowClassifier.
+     * \param classifier the classifier of the IPv4 probes
+     */
+    void SetClassifier(Ptr<Ipv4FlowClassifier> classifier);
+
     /**
      * \brief Retrieve the FlowClassifier object for IPv4 created by the Install* methods
      * \returns a pointer to the FlowClassifier object
@@ -120,10 +163,18 @@ class FlowMonitorHelper
     void SerializeToXmlFile(std::string fileName, bool enableHistograms, bool enableProbes);
 
   private:
-    ObjectFactory m_monitorFactory;        //!< Object factory
-    Ptr<FlowMonitor> m_flowMonitor;        //!< the FlowMonitor object
-    Ptr<FlowClassifier> m_flowClassifier4; //!< the FlowClassifier object for IPv4
-    Ptr<FlowClassifier> m_flowClassifier6; //!< the FlowClassifier object for IPv6
+    /**
+     * \brief Retrieve the probe configuration, creating it on the first Install*
+     * \returns a pointer to the BigBrotherProbeConfig object
+     */
+    Ptr<BigBrotherProbeConfig> GetProbeConfig();
+
+    ObjectFactory m_monitorFactory;           //!< Object factory
+    Ptr<FlowMonitor> m_flowMonitor;           //!< the FlowMonitor object
+    Ptr<FlowClassifier> m_flowClassifier4;    //!< the FlowClassifier object for IPv4
+    Ptr<FlowClassifier> m_flowClassifier6;    //!< the FlowClassifier object for IPv6
+    ObjectFactory m_probeConfigFactory;       //!< BigBrotherProbeConfig factory
+    Ptr<BigBrotherProbeConfig> m_probeConfig; //!< configuration of the installed probes
 };
 
 } // namespace ns3
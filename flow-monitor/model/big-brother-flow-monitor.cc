@@ -21,10 +21,13 @@
 
 #include "ipv4-flow-probe.h"
 #include "big-brother-flow-probe.h"
+#include "ns3/abort.h"
 #include "ns3/double.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/string.h"
 
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
@@ -82,7 +85,61 @@ FlowMonitor::GetTypeId()
                 ("The minimum inter-arrival time that is considered a flow interruption."),
                 TimeValue(Seconds(0.5)),
                 MakeTimeAccessor(&FlowMonitor::m_flowInterruptionsMinTime),
-                MakeTimeChecker());
+                MakeTimeChecker())
+            .AddAttribute("FlowIdleTimeout",
+                          ("Time without transmissions after which FlowIdle is fired for a flow.  "
+                           "Every flow has its own timer, restarted by its transmissions."),
+                          TimeValue(Seconds(1.0)),
+                          MakeTimeAccessor(&FlowMonitor::m_flowIdleTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("DelayThreshold",
+                          ("End-to-end delay checked by the ThresholdCrossed trace source.  "
+                           "Zero disables the check."),
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&FlowMonitor::m_delayThreshold),
+                          MakeTimeChecker())
+            .AddAttribute("FlowEvictionTimeout",
+                          ("Time without transmissions nor receptions after which a flow is "
+                           "archived and removed from memory.  Zero disables the eviction."),
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&FlowMonitor::m_flowEvictionTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("FlowArchiveFile",
+                          ("File the stats of the evicted flows are appended to.  "
+                           "Empty discards them."),
+                          StringValue(""),
+                          MakeStringAccessor(&FlowMonitor::m_archiveFileName),
+                          MakeStringChecker())
+            .AddAttribute("FlowArchiveFormat",
+                          ("Format of FlowArchiveFile: \"csv\", or \"binary\" for fixed-size "
+                           "host-endian records"),
+                          StringValue("csv"),
+                          MakeStringAccessor(&FlowMonitor::m_archiveFormat),
+                          MakeStringChecker())
+            .AddTraceSource("FlowStarted",
+                            "The first packet of a flow was transmitted.",
+                            MakeTraceSourceAccessor(&FlowMonitor::m_flowStartedTrace),
+                            "ns3::FlowMonitor::FlowEventTracedCallback")
+            .AddTraceSource("FlowIdle",
+                            "A flow did not transmit for FlowIdleTimeout.",
+                            MakeTraceSourceAccessor(&FlowMonitor::m_flowIdleTrace),
+                            "ns3::FlowMonitor::FlowEventTracedCallback")
+            .AddTraceSource("FlowEvicted",
+                            "An idle flow was evicted after FlowEvictionTimeout.",
+                            MakeTraceSourceAccessor(&FlowMonitor::m_flowEvictedTrace),
+                            "ns3::FlowMonitor::FlowEventTracedCallback")
+            .AddTraceSource("PacketLost",
+                            "A tracked packet was not seen for MaxPerHopDelay.",
+                            MakeTraceSourceAccessor(&FlowMonitor::m_packetLostTrace),
+                            "ns3::FlowMonitor::PacketLostTracedCallback")
+            .AddTraceSource("ThresholdCrossed",
+                            "The end-to-end delay of a flow crossed DelayThreshold, either way.",
+                            MakeTraceSourceAccessor(&FlowMonitor::m_thresholdTrace),
+                            "ns3::FlowMonitor::ThresholdTracedCallback")
+            .AddTraceSource("DropObserved",
+                            "A probe reported a packet drop.",
+                            MakeTraceSourceAccessor(&FlowMonitor::m_dropTrace),
+                            "ns3::FlowMonitor::DropTracedCallback");
     return tid;
 }
 
@@ -93,7 +150,8 @@ FlowMonitor::GetInstanceTypeId() const
 }
 
 FlowMonitor::FlowMonitor()
-    : m_enabled(false)
+    : m_flowIdCounter(Create<FlowIdCounter>()),
+      m_enabled(false)
 {
     NS_LOG_FUNCTION(this);
 }
@@ -104,6 +162,10 @@ FlowMonitor::DoDispose()
     NS_LOG_FUNCTION(this);
     Simulator::Cancel(m_startEvent);
     Simulator::Cancel(m_stopEvent);
+    if (m_archive.is_open())
+    {
+        m_archive.close();
+    }
     for (auto iter = m_classifiers.begin(); iter != m_classifiers.end(); iter++)
     {
         *iter = nullptr;
@@ -113,6 +175,14 @@ FlowMonitor::DoDispose()
         m_flowProbes[i]->Dispose();
         m_flowProbes[i] = nullptr;
     }
+    m_flowObservers.clear();
+    for (auto& [flowId, idleTimer] : m_idleTimers)
+    {
+        idleTimer.Cancel();
+    }
+    m_idleTimers.clear();
+    m_hotCounters = HotCounters();
+    m_hotRows.clear();
     Object::DoDispose();
 }
 
@@ -137,6 +207,13 @@ FlowMonitor::GetStatsForFlow(FlowId flowId)
         ref.jitterHistogram.SetDefaultBinWidth(m_jitterBinWidth);
         ref.packetSizeHistogram.SetDefaultBinWidth(m_packetSizeBinWidth);
         ref.flowInterruptionsHistogram.SetDefaultBinWidth(m_flowInterruptionsBinWidth);
+        m_hotRows[flowId] = m_hotCounters.flowId.size();
+        m_hotCounters.flowId.push_back(flowId);
+        m_hotCounters.rxBytes.push_back(0);
+        m_hotCounters.rxPackets.push_back(0);
+        m_hotCounters.delaySum.push_back(0);
+        m_hotCounters.jitterSum.push_back(0);
+        m_hotCounters.lastDelay.push_back(0);
         return ref;
     }
     else
@@ -164,9 +241,10 @@ FlowMonitor::ReportFirstTx(Ptr<FlowProbe> probe,
     tracked.timesForwarded = 0;
     NS_LOG_DEBUG("ReportFirstTx: adding tracked packet (flowId=" << flowId << ", packetId="
                                                                  << packetId << ").");
-    Ptr<BigBrotherFlowProbe> bigBrotherProbe = DynamicCast<BigBrotherFlowProbe>(probe);
-    bigBrotherProbe->AddPacketStats(flowId,packetId, packetSize, Seconds(0));
+    probe->AddPacketStats(flowId, packetId, packetSize, Seconds(0));
 
+    // ResetAllStats() zeroes txPackets, so new flows are told apart by their entry
+    bool newFlow = !m_flowStartedTrace.IsEmpty() && m_flowStats.find(flowId) == m_flowStats.end();
     FlowStats& stats = GetStatsForFlow(flowId);
     stats.txBytes += packetSize;
     stats.txPackets++;
@@ -175,6 +253,16 @@ FlowMonitor::ReportFirstTx(Ptr<FlowProbe> probe,
         stats.timeFirstTxPacket = now;
     }
     stats.timeLastTxPacket = now;
+    // The timer of a flow that keeps transmitting is only pushed back when it expires
+    if (!m_flowIdleTrace.IsEmpty() && m_idleTimers.find(flowId) == m_idleTimers.end())
+    {
+        m_idleTimers[flowId] =
+            Simulator::Schedule(m_flowIdleTimeout, &FlowMonitor::CheckForIdleFlow, this, flowId);
+    }
+    if (newFlow)
+    {
+        m_flowStartedTrace(FlowEvent{flowId, now});
+    }
 }
 
 void
@@ -202,8 +290,7 @@ FlowMonitor::ReportForwarding(Ptr<FlowProbe> probe,
     tracked->second.lastSeenTime = Simulator::Now();
 
     Time delay = (Simulator::Now() - tracked->second.firstSeenTime);
-    Ptr<BigBrotherFlowProbe> bigBrotherProbe = DynamicCast<BigBrotherFlowProbe>(probe);
-    bigBrotherProbe->AddPacketStats(flowId,packetId, packetSize, delay);
+    probe->AddPacketStats(flowId, packetId, packetSize, delay);
 }
 
 void
@@ -228,8 +315,7 @@ FlowMonitor::ReportLastRx(Ptr<FlowProbe> probe,
 
     Time now = Simulator::Now();
     Time delay = (now - tracked->second.firstSeenTime);
-    Ptr<BigBrotherFlowProbe> bigBrotherProbe = DynamicCast<BigBrotherFlowProbe>(probe);
-    bigBrotherProbe->AddPacketStats(flowId,packetId, packetSize, delay);
+    probe->AddPacketStats(flowId, packetId, packetSize, delay);
 
     FlowStats& stats = GetStatsForFlow(flowId);
     stats.delaySum += delay;
@@ -250,6 +336,24 @@ FlowMonitor::ReportLastRx(Ptr<FlowProbe> probe,
     }
     stats.lastDelay = delay;
 
+    if (m_delayThreshold.IsStrictlyPositive() && !m_thresholdTrace.IsEmpty())
+    {
+        bool above = delay > m_delayThreshold;
+        bool wasAbove = m_flowsAboveThreshold.count(flowId) > 0;
+        if (above != wasAbove)
+        {
+            if (above)
+            {
+                m_flowsAboveThreshold.insert(flowId);
+            }
+            else
+            {
+                m_flowsAboveThreshold.erase(flowId);
+            }
+            m_thresholdTrace(ThresholdEvent{flowId, packetId, delay, above});
+        }
+    }
+
     stats.rxBytes += packetSize;
     stats.packetSizeHistogram.AddValue((double)packetSize);
     stats.rxPackets++;
@@ -268,6 +372,7 @@ FlowMonitor::ReportLastRx(Ptr<FlowProbe> probe,
     }
     stats.timeLastRxPacket = now;
     stats.timesForwarded += tracked->second.timesForwarded;
+    UpdateHotCounters(flowId, stats);
 
     NS_LOG_DEBUG("ReportLastTx: removing tracked packet (flowId=" << flowId << ", packetId="
                                                                   << packetId << ").");
@@ -289,7 +394,11 @@ FlowMonitor::ReportDrop(Ptr<FlowProbe> probe,
         return;
     }
 
-    probe->AddPacketDropStats(flowId, packetSize, reasonCode);
+    probe->AddPacketDropStats(flowId, packetId, packetSize, reasonCode);
+    if (!m_dropTrace.IsEmpty())
+    {
+        m_dropTrace(DropEvent{flowId, packetId, packetSize, reasonCode, PeekPointer(probe)});
+    }
 
     FlowStats& stats = GetStatsForFlow(flowId);
     stats.lostPackets++;
@@ -314,6 +423,48 @@ FlowMonitor::ReportDrop(Ptr<FlowProbe> probe,
     }
 }
 
+void
+FlowMonitor::UpdateHotCounters(FlowId flowId, const FlowStats& stats)
+{
+    uint32_t row = m_hotRows.at(flowId);
+    m_hotCounters.rxBytes[row] = stats.rxBytes;
+    m_hotCounters.rxPackets[row] = stats.rxPackets;
+    m_hotCounters.delaySum[row] = stats.delaySum.GetNanoSeconds();
+    m_hotCounters.jitterSum[row] = stats.jitterSum.GetNanoSeconds();
+    m_hotCounters.lastDelay[row] = stats.lastDelay.GetNanoSeconds();
+}
+
+void
+FlowMonitor::RemoveHotCounters(FlowId flowId)
+{
+    auto hotRow = m_hotRows.find(flowId);
+    uint32_t row = hotRow->second;
+    uint32_t last = m_hotCounters.flowId.size() - 1;
+    m_hotRows.erase(hotRow);
+    if (row != last)
+    {
+        m_hotCounters.flowId[row] = m_hotCounters.flowId[last];
+        m_hotCounters.rxBytes[row] = m_hotCounters.rxBytes[last];
+        m_hotCounters.rxPackets[row] = m_hotCounters.rxPackets[last];
+        m_hotCounters.delaySum[row] = m_hotCounters.delaySum[last];
+        m_hotCounters.jitterSum[row] = m_hotCounters.jitterSum[last];
+        m_hotCounters.lastDelay[row] = m_hotCounters.lastDelay[last];
+        m_hotRows[m_hotCounters.flowId[row]] = row;
+    }
+    m_hotCounters.flowId.pop_back();
+    m_hotCounters.rxBytes.pop_back();
+    m_hotCounters.rxPackets.pop_back();
+    m_hotCounters.delaySum.pop_back();
+    m_hotCounters.jitterSum.pop_back();
+    m_hotCounters.lastDelay.pop_back();
+}
+
+const FlowMonitor::HotCounters&
+FlowMonitor::GetHotCounters() const
+{
+    return m_hotCounters;
+}
+
 const FlowMonitor::FlowStatsContainer&
 FlowMonitor::GetFlowStats() const
 {
@@ -334,6 +485,11 @@ FlowMonitor::CheckForLostPackets(Time maxDelay)
             auto flow = m_flowStats.find(iter->first.first);
             NS_ASSERT(flow != m_flowStats.end());
             flow->second.lostPackets++;
+            if (!m_packetLostTrace.IsEmpty())
+            {
+                m_packetLostTrace(
+                    PacketLostEvent{iter->first.first, iter->first.second, iter->second.lastSeenTime});
+            }
 
             // we won't track it anymore
             m_trackedPackets.erase(iter++);
@@ -351,10 +507,202 @@ FlowMonitor::CheckForLostPackets()
     CheckForLostPackets(m_maxPerHopDelay);
 }
 
+void
+FlowMonitor::CheckForIdleFlow(FlowId flowId)
+{
+    const FlowStats& stats = m_flowStats[flowId];
+    Time silence = Simulator::Now() - stats.timeLastTxPacket;
+    if (silence < m_flowIdleTimeout)
+    {
+        m_idleTimers[flowId] = Simulator::Schedule(m_flowIdleTimeout - silence,
+                                                   &FlowMonitor::CheckForIdleFlow,
+                                                   this,
+                                                   flowId);
+        return;
+    }
+    m_idleTimers.erase(flowId);
+    m_flowIdleTrace(FlowEvent{flowId, stats.timeLastTxPacket});
+}
+
+uint32_t
+FlowMonitor::EvictIdleFlows(Time idleTimeout)
+{
+    NS_LOG_FUNCTION(this << idleTimeout.As(Time::S));
+    Time now = Simulator::Now();
+    uint32_t evicted = 0;
+    for (auto iter = m_flowStats.begin(); iter != m_flowStats.end();)
+    {
+        FlowId flowId = iter->first;
+        Time lastSeen = std::max(iter->second.timeLastTxPacket, iter->second.timeLastRxPacket);
+        // Packets in flight are received or declared lost before their flow goes
+        auto tracked = m_trackedPackets.lower_bound(std::make_pair(flowId, FlowPacketId(0)));
+        bool inFlight = tracked != m_trackedPackets.end() && tracked->first.first == flowId;
+        if (now - lastSeen < idleTimeout || inFlight)
+        {
+            ++iter;
+            continue;
+        }
+
+        if (!m_archiveFileName.empty())
+        {
+            ArchiveFlow(flowId, iter->second);
+        }
+        for (Ptr<FlowClassifier> classifier : m_classifiers)
+        {
+            classifier->ForgetFlow(flowId);
+        }
+        for (Ptr<FlowProbe> probe : m_flowProbes)
+        {
+            probe->ForgetFlow(flowId);
+        }
+        // Only the probes that saw the flow hold its hops
+        auto observers = m_flowObservers.find(flowId);
+        if (observers != m_flowObservers.end())
+        {
+            for (Ptr<FlowProbe> probe : observers->second)
+            {
+                BigBrotherHopStore::Get(probe)->ForgetFlowPackets(flowId);
+            }
+            m_flowObservers.erase(observers);
+        }
+        auto idleTimer = m_idleTimers.find(flowId);
+        if (idleTimer != m_idleTimers.end())
+        {
+            idleTimer->second.Cancel();
+            m_idleTimers.erase(idleTimer);
+        }
+        m_flowsAboveThreshold.erase(flowId);
+        m_flowTotals.erase(flowId);
+        RemoveHotCounters(flowId);
+        m_flowEvictedTrace(FlowEvent{flowId, iter->second.timeLastTxPacket});
+        iter = m_flowStats.erase(iter);
+        ++evicted;
+    }
+    if (evicted > 0 && m_archive.is_open())
+    {
+        m_archive.flush();
+    }
+    NS_LOG_DEBUG("Evicted " << evicted << " flows, " << m_flowStats.size() << " remain");
+    return evicted;
+}
+
+/// Append a value to a binary archive, in host byte order
+/// \param os the archive
+/// \param value the value
+template <typename T>
+static void
+WriteRaw(std::ostream& os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void
+FlowMonitor::AddToTotals(FlowTotals& totals, const FlowStats& stats)
+{
+    // The first packets of the flow are in the first window that has some
+    if (totals.txPackets == 0 && stats.txPackets > 0)
+    {
+        totals.timeFirstTxPacket = stats.timeFirstTxPacket;
+    }
+    if (totals.rxPackets == 0 && stats.rxPackets > 0)
+    {
+        totals.timeFirstRxPacket = stats.timeFirstRxPacket;
+    }
+    totals.delaySum += stats.delaySum;
+    totals.jitterSum += stats.jitterSum;
+    totals.txBytes += stats.txBytes;
+    totals.rxBytes += stats.rxBytes;
+    totals.txPackets += stats.txPackets;
+    totals.rxPackets += stats.rxPackets;
+    totals.lostPackets += stats.lostPackets;
+    totals.timesForwarded += stats.timesForwarded;
+}
+
+void
+FlowMonitor::ArchiveFlow(FlowId flowId, const FlowStats& stats)
+{
+    bool binary = m_archiveFormat == "binary";
+    if (!m_archive.is_open())
+    {
+        NS_ABORT_MSG_IF(!binary && m_archiveFormat != "csv",
+                        "Unknown FlowArchiveFormat " << m_archiveFormat);
+        m_archive.open(m_archiveFileName, std::ios::out | std::ios::app | std::ios::binary);
+        NS_ABORT_MSG_IF(!m_archive.is_open(), "Cannot open " << m_archiveFileName);
+        m_archive.seekp(0, std::ios::end);
+        if (!binary && m_archive.tellp() == 0)
+        {
+            m_archive << "flowId,sourceAddress,destinationAddress,protocol,sourcePort,"
+                         "destinationPort,timeFirstTxPacket,timeFirstRxPacket,timeLastTxPacket,"
+                         "timeLastRxPacket,delaySum,jitterSum,txBytes,rxBytes,txPackets,"
+                         "rxPackets,lostPackets,timesForwarded\n";
+        }
+    }
+
+    FlowTotals totals;
+    auto closed = m_flowTotals.find(flowId);
+    if (closed != m_flowTotals.end())
+    {
+        totals = closed->second;
+    }
+    AddToTotals(totals, stats);
+
+    std::ostringstream key;
+    bool known = false;
+    for (auto classifier = m_classifiers.begin(); !known && classifier != m_classifiers.end();
+         classifier++)
+    {
+        known = (*classifier)->WriteFlowKey(key, flowId);
+    }
+    if (!known)
+    {
+        key << ",,,,";
+    }
+
+    if (binary)
+    {
+        // flowId, key length and key text, then the fields of the CSV header;
+        // times are in nanoseconds
+        std::string text = key.str();
+        WriteRaw<uint32_t>(m_archive, flowId);
+        WriteRaw<uint16_t>(m_archive, text.size());
+        m_archive.write(text.data(), text.size());
+        for (const Time& time : {totals.timeFirstTxPacket,
+                                 totals.timeFirstRxPacket,
+                                 stats.timeLastTxPacket,
+                                 stats.timeLastRxPacket,
+                                 totals.delaySum,
+                                 totals.jitterSum})
+        {
+            WriteRaw<int64_t>(m_archive, time.GetNanoSeconds());
+        }
+        WriteRaw<uint64_t>(m_archive, totals.txBytes);
+        WriteRaw<uint64_t>(m_archive, totals.rxBytes);
+        WriteRaw<uint32_t>(m_archive, totals.txPackets);
+        WriteRaw<uint32_t>(m_archive, totals.rxPackets);
+        WriteRaw<uint32_t>(m_archive, totals.lostPackets);
+        WriteRaw<uint32_t>(m_archive, totals.timesForwarded);
+    }
+    else
+    {
+        m_archive << flowId << "," << key.str() << "," << totals.timeFirstTxPacket.GetNanoSeconds()
+                  << "," << totals.timeFirstRxPacket.GetNanoSeconds() << ","
+                  << stats.timeLastTxPacket.GetNanoSeconds() << ","
+                  << stats.timeLastRxPacket.GetNanoSeconds() << ","
+                  << totals.delaySum.GetNanoSeconds() << "," << totals.jitterSum.GetNanoSeconds()
+                  << "," << totals.txBytes << "," << totals.rxBytes << "," << totals.txPackets << ","
+                  << totals.rxPackets << "," << totals.lostPackets << "," << totals.timesForwarded
+                  << "\n";
+    }
+}
+
 void
 FlowMonitor::PeriodicCheckForLostPackets()
 {
     CheckForLostPackets();
+    if (m_flowEvictionTimeout.IsStrictlyPositive())
+    {
+        EvictIdleFlows(m_flowEvictionTimeout);
+    }
     Simulator::Schedule(PERIODIC_CHECK_INTERVAL, &FlowMonitor::PeriodicCheckForLostPackets, this);
 }
 
@@ -377,6 +725,33 @@ FlowMonitor::GetAllProbes() const
     return m_flowProbes;
 }
 
+void
+FlowMonitor::AddFlowObserver(FlowId flowId, Ptr<FlowProbe> probe)
+{
+    NS_LOG_FUNCTION(this << flowId << probe);
+    m_flowObservers[flowId].push_back(probe);
+}
+
+bool
+FlowMonitor::GetDelayFromFirstProbe(FlowId flowId, FlowPacketId packetId, Time* delay) const
+{
+    auto tracked = m_trackedPackets.find(std::make_pair(flowId, packetId));
+    if (tracked == m_trackedPackets.end())
+    {
+        return false;
+    }
+    *delay = Simulator::Now() - tracked->second.firstSeenTime;
+    return true;
+}
+
+const FlowMonitor::FlowProbeContainer&
+FlowMonitor::GetFlowObservers(FlowId flowId) const
+{
+    static const FlowProbeContainer none;
+    auto iter = m_flowObservers.find(flowId);
+    return iter == m_flowObservers.end() ? none : iter->second;
+}
+
 void
 FlowMonitor::Start(const Time& time)
 {
@@ -428,9 +803,16 @@ FlowMonitor::StopRightNow()
 void
 FlowMonitor::AddFlowClassifier(Ptr<FlowClassifier> classifier)
 {
+    classifier->SetFlowIdCounter(m_flowIdCounter);
     m_classifiers.push_back(classifier);
 }
 
+const std::list<Ptr<FlowClassifier>>&
+FlowMonitor::GetFlowClassifiers() const
+{
+    return m_classifiers;
+}
+
 void
 FlowMonitor::SerializeToXmlStream(std::ostream& os,
                                   uint16_t indent,
@@ -537,13 +919,21 @@ FlowMonitor::ResetAllStats()
 {
     NS_LOG_FUNCTION(this);
 
-    FlowMonitor::FlowProbeContainer probes = this->GetAllProbes() ;
-    std::map<FlowId,uint32_t> startIndex;
+    // We clear all our traces of big-brother-probes: their per-hop records only hold the
+    // current window. Called by every report, so nothing here allocates per flow
+    for (const Ptr<FlowProbe>& probe : m_flowProbes)
+    {
+        probe->ClearPerPacketStats();
+    }
     for (auto& iter : m_flowStats)
     {
         auto& flowStat = iter.second;
 
-        startIndex.emplace(std::make_pair(iter.first,flowStat.rxPackets + 1));
+        // The archive keeps the lifetime stats of the flows
+        if (!m_archiveFileName.empty())
+        {
+            AddToTotals(m_flowTotals[iter.first], flowStat);
+        }
 
         flowStat.delaySum = Seconds(0);
         flowStat.jitterSum = Seconds(0);
@@ -562,25 +952,11 @@ FlowMonitor::ResetAllStats()
         flowStat.packetSizeHistogram.Clear();
         flowStat.flowInterruptionsHistogram.Clear();
     }
-    // We now clear all our traces of big-brother-probes:
-    for (ns3::Ptr<ns3::FlowProbe> probe : probes)
-    {
-        Ptr<BigBrotherFlowProbe> bigBrotherProbe = DynamicCast<BigBrotherFlowProbe>(probe);
-        // We only measure in the probes that are ipv4/bigBrother
-        if (bigBrotherProbe)
-        {
-            bigBrotherProbe->m_perPacketStats.clear();
-            for (std::map<FlowId,uint32_t>::iterator it = bigBrotherProbe->m_packetStartIndex.begin(); it !=bigBrotherProbe->m_packetStartIndex.end(); it++ ){
-                std::map<FlowId,uint32_t>::const_iterator indexIt = startIndex.find(it->first);
-                if (indexIt != startIndex.end()) {
-                    it->second = indexIt->second;
-                } else {
-                    std::cerr << "You fucked up along the way" << std::endl;
-                }
-                
-            }
-        }
-    }
+    std::fill(m_hotCounters.rxBytes.begin(), m_hotCounters.rxBytes.end(), 0);
+    std::fill(m_hotCounters.rxPackets.begin(), m_hotCounters.rxPackets.end(), 0);
+    std::fill(m_hotCounters.delaySum.begin(), m_hotCounters.delaySum.end(), 0);
+    std::fill(m_hotCounters.jitterSum.begin(), m_hotCounters.jitterSum.end(), 0);
+    std::fill(m_hotCounters.lastDelay.begin(), m_hotCounters.lastDelay.end(), 0);
 }
 
 } // namespace ns3
@@ -1,52 +1,190 @@
 #include "big-brother-flow-probe.h"
-#include "flow-monitor.h"
-#include "flow-probe.h"
-#include "ipv4-flow-probe.h"
-#include "ipv4-flow-classifier.h"
 
-#include "ns3/ipv4-l3-protocol.h"
-#include "ns3/queue-item.h"
-
-#include <map>
-#include "ns3/config.h"
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/double.h"
 #include "ns3/log.h"
 #include "ns3/node.h"
-#include "ns3/packet.h"
-#include "ns3/pointer.h"
 
 namespace ns3
 {
 
-BigBrotherFlowProbe::BigBrotherFlowProbe(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Ptr<Node> node)
-    : Ipv4FlowProbe(monitor, classifier, node),
-      m_nodeId(node->GetId()),
-      m_perPacketStats{},
-      m_packetStartIndex{}
+NS_LOG_COMPONENT_DEFINE("BigBrotherFlowProbe");
+
+NS_OBJECT_ENSURE_REGISTERED(BigBrotherProbeConfig);
+
+TypeId
+BigBrotherProbeConfig::GetTypeId()
 {
+    static TypeId tid =
+        TypeId("ns3::BigBrotherProbeConfig")
+            .SetParent<Object>()
+            .SetGroupName("FlowMonitor")
+            .AddConstructor<BigBrotherProbeConfig>()
+            .AddAttribute("ProbeFlowStats",
+                          "Update the per-flow stats of the probes.",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&BigBrotherProbeConfig::m_probeFlowStats),
+                          MakeBooleanChecker())
+            .AddAttribute("PerHopRecording",
+                          "Record every hop of every packet, for the node-to-node delays.",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&BigBrotherProbeConfig::m_perHop),
+                          MakeBooleanChecker())
+            .AddAttribute("DropTracking",
+                          "Record the drops per flow and per packet.",
+                          BooleanValue(true),
+                          MakeBooleanAccessor(&BigBrotherProbeConfig::m_drops),
+                          MakeBooleanChecker())
+            .AddAttribute("InterfaceCounters",
+                          "Count the packets and bytes of every interface.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&BigBrotherProbeConfig::m_interfaceCounters),
+                          MakeBooleanChecker())
+            .AddAttribute("SamplingRate",
+                          ("Fraction of the packets whose hops are recorded; values "
+                           "below 1 enable sampling."),
+                          DoubleValue(1.0),
+                          MakeDoubleAccessor(&BigBrotherProbeConfig::m_samplingRate),
+                          MakeDoubleChecker<double>(0, 1));
+    return tid;
 }
 
-BigBrotherFlowProbe::~BigBrotherFlowProbe()
+BigBrotherProbeConfig::BigBrotherProbeConfig()
+{
+}
+
+BigBrotherProbeConfig::~BigBrotherProbeConfig()
+{
+}
+
+uint32_t
+BigBrotherProbeConfig::GetFeatures() const
+{
+    using namespace bigbrother;
+    return (m_probeFlowStats ? ProbeFlowStats::mask : 0) | (m_perHop ? PerHop::mask : 0) |
+           (m_drops ? Drops::mask : 0) | (m_interfaceCounters ? InterfaceCounters::mask : 0) |
+           (m_samplingRate < 1.0 ? Sampling::mask : 0);
+}
+
+double
+BigBrotherProbeConfig::GetSamplingRate() const
+{
+    return m_samplingRate;
+}
+
+BigBrotherHopStore::BigBrotherHopStore(uint32_t nodeId)
+    : m_nodeId(nodeId),
+      m_flowHops{},
+      m_seenFlows{},
+      m_perPacketDrops{},
+      m_samplingThreshold(1ULL << 32)
+{
+}
+
+BigBrotherHopStore::~BigBrotherHopStore()
+{
+}
+
+BigBrotherHopStore* BigBrotherHopStore::Get(Ptr<FlowProbe> probe)
+{
+    return dynamic_cast<BigBrotherHopStore*>(PeekPointer(probe));
+}
+
+void BigBrotherHopStore::SetSamplingRate(double rate)
+{
+    NS_ABORT_MSG_IF(!(rate >= 0.0 && rate <= 1.0), "Sampling rate " << rate << " is not in [0, 1]");
+    m_samplingThreshold = static_cast<uint64_t>(rate * static_cast<double>(1ULL << 32));
+}
+
+const std::vector<BigBrotherHopStore::InterfaceStats>&
+BigBrotherHopStore::GetInterfaceStats() const
 {
+    return m_interfaceStats;
 }
 
-void BigBrotherFlowProbe::AddPacketStats(FlowId flowId, uint32_t packetId, uint32_t packetSize, Time delayFromFirstProbe)
+const std::vector<BigBrotherHopStore::Hop>*
+BigBrotherHopStore::GetFlowHops(FlowId flowId) const
 {
-    // Update the overall flow stats
-    Ipv4FlowProbe::AddPacketStats(flowId, packetSize, delayFromFirstProbe);
+    FlowHops::const_iterator it = m_flowHops.find(flowId);
+    return it == m_flowHops.end() ? nullptr : &it->second;
+}
 
-    //If the flow is new, we initialize packetStartIndex
-    m_packetStartIndex.emplace(std::make_pair(flowId,0));
+void BigBrotherHopStore::ClearPerPacketStats()
+{
+    // The lists keep their capacity for the next measurement window
+    for (auto& [flowId, hops] : m_flowHops)
+    {
+        hops.clear();
+    }
+    m_perPacketDrops.clear();
+}
+
+void BigBrotherHopStore::ForgetFlowPackets(FlowId flowId)
+{
+    auto first = std::make_pair(flowId, FlowPacketId(0));
+    auto last = std::make_pair(flowId + 1, FlowPacketId(0));
+    m_flowHops.erase(flowId);
+    m_perPacketDrops.erase(m_perPacketDrops.lower_bound(first), m_perPacketDrops.lower_bound(last));
+    m_seenFlows.erase(flowId);
+}
+
+bool BigBrotherHopStore::RecordHop(FlowId flowId, FlowPacketId packetId, uint32_t packetSize, Time delayFromFirstProbe)
+{
+    bool newFlow = m_seenFlows.insert(flowId).second;
 
     // Update bigBrothers stats
-    std::pair<std::map<std::pair<uint32_t,uint32_t>, FlowProbe::FlowStats>::iterator,bool> insert= this->m_perPacketStats.emplace(std::make_pair(flowId, packetId),  FlowProbe::FlowStats());
-    if (insert.second) {
-        std::map<std::pair<uint32_t,uint32_t>, FlowProbe::FlowStats>::iterator perPacketStatsIt = insert.first;
-        perPacketStatsIt->second.bytes += packetSize;
-        perPacketStatsIt->second.packets++;
-        perPacketStatsIt->second.delayFromFirstProbeSum += delayFromFirstProbe;
-    } else {
-       std::cerr<< "Error inserting (flow_id,packet_id)->FlowProbe::FlowStat into big-brother-probe, key already existed" << std::endl; 
+    std::vector<Hop>& hops = m_flowHops[flowId];
+    if (!hops.empty() && hops.back().packetId == packetId) {
+        NS_LOG_WARN("Node " << m_nodeId << " already has a hop of packet " << packetId << " of flow "
+                            << flowId << "; the new one is ignored");
+        return newFlow;
     }
+    hops.push_back(Hop{packetId, PacketStats{delayFromFirstProbe, packetSize}});
+    return newFlow;
+}
+
+bool BigBrotherHopStore::RecordDrop(FlowId flowId, FlowPacketId packetId, uint32_t reasonCode)
+{
+    bool newFlow = m_seenFlows.insert(flowId).second;
+    m_perPacketDrops.insert_or_assign(std::make_pair(flowId, packetId), reasonCode);
+    return newFlow;
+}
+
+void BigBrotherHopStore::CountInterface(uint32_t interface, uint32_t packetSize, bool dropped)
+{
+    if (interface == Ipv4::IF_ANY)
+    {
+        return;
+    }
+    if (m_interfaceStats.size() <= interface)
+    {
+        m_interfaceStats.resize(interface + 1);
+    }
+    InterfaceStats& stats = m_interfaceStats[interface];
+    if (dropped)
+    {
+        ++stats.packetsDropped;
+        return;
+    }
+    stats.bytes += packetSize;
+    ++stats.packets;
+}
+
+BigBrotherFlowProbe::BigBrotherFlowProbe(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Ptr<Node> node)
+    : Ipv4FlowProbe(monitor, classifier, node),
+      BigBrotherHopStore(node->GetId())
+{
+}
+
+BigBrotherFlowProbe::~BigBrotherFlowProbe()
+{
+}
+
+void
+BigBrotherFlowProbe::ClearPerPacketStats()
+{
+    BigBrotherHopStore::ClearPerPacketStats();
 }
 
 /* static */
@@ -60,4 +198,59 @@ BigBrotherFlowProbe::GetTypeId()
     return tid;
 }
 
-} // namespace ns3
\ No newline at end of file
+Ipv6BigBrotherFlowProbe::Ipv6BigBrotherFlowProbe(Ptr<FlowMonitor> monitor, Ptr<Ipv6FlowClassifier> classifier, Ptr<Node> node)
+    : Ipv6FlowProbe(monitor, classifier, node),
+      BigBrotherHopStore(node->GetId())
+{
+}
+
+Ipv6BigBrotherFlowProbe::~Ipv6BigBrotherFlowProbe()
+{
+}
+
+void
+Ipv6BigBrotherFlowProbe::ClearPerPacketStats()
+{
+    BigBrotherHopStore::ClearPerPacketStats();
+}
+
+/* static */
+TypeId
+Ipv6BigBrotherFlowProbe::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::Ipv6BigBrotherFlowProbe").SetParent<Ipv6FlowProbe>().SetGroupName("FlowMonitor")
+        // No AddConstructor because this class has no default constructor.
+        ;
+    return tid;
+}
+
+Ptr<BigBrotherFlowProbe>
+CreateBigBrotherFlowProbe(uint32_t features,
+                          Ptr<FlowMonitor> monitor,
+                          Ptr<Ipv4FlowClassifier> classifier,
+                          Ptr<Node> node)
+{
+    using namespace bigbrother;
+    return BigBrotherProbeFactory<
+        BigBrotherFlowProbe,
+        BigBrotherFeatureList<>,
+        BigBrotherFeatureList<ProbeFlowStats, PerHop, Drops, InterfaceCounters, Sampling>>::
+        Create(features, monitor, classifier, node);
+}
+
+Ptr<Ipv6BigBrotherFlowProbe>
+CreateIpv6BigBrotherFlowProbe(uint32_t features,
+                              Ptr<FlowMonitor> monitor,
+                              Ptr<Ipv6FlowClassifier> classifier,
+                              Ptr<Node> node)
+{
+    using namespace bigbrother;
+    return BigBrotherProbeFactory<
+        Ipv6BigBrotherFlowProbe,
+        BigBrotherFeatureList<>,
+        BigBrotherFeatureList<ProbeFlowStats, PerHop, Drops, InterfaceCounters, Sampling>>::
+        Create(features, monitor, classifier, node);
+}
+
+} // namespace ns3
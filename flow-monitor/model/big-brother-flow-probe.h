@@ -2,44 +2,433 @@
 #ifndef BIG_BROTHER_FLOW_PROBE_H
 #define BIG_BROTHER_FLOW_PROBE_H
 
+#include "flow-monitor.h"
 #include "flow-probe.h"
 #include "ipv4-flow-probe.h"
 #include "ipv4-flow-classifier.h"
+#include "ipv6-flow-classifier.h"
+#include "ipv6-flow-probe.h"
 
 #include "ns3/ipv4-l3-protocol.h"
+#include "ns3/ipv6-l3-protocol.h"
+#include "ns3/object.h"
 #include "ns3/queue-item.h"
 
 #include <map>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 namespace ns3
 {
 
-class FlowMonitor;
 class Node;
 
+/// Compile-time features that a BasicBigBrotherProbe can be built with.
+/// Each feature is a tag type carrying the bit used by the helper to
+/// select an instantiation at runtime.
+namespace bigbrother
+{
+/// Update the per-flow FlowProbe::FlowStats of the probe (GetStats())
+struct ProbeFlowStats
+{
+    static constexpr uint32_t mask = 1 << 0; //!< feature bit
+};
+
+/// Record every hop of every packet in m_flowHops
+struct PerHop
+{
+    static constexpr uint32_t mask = 1 << 1; //!< feature bit
+};
+
+/// Track drops, both per flow and per (flow, packet)
+struct Drops
+{
+    static constexpr uint32_t mask = 1 << 2; //!< feature bit
+};
+
+/// Count packets and bytes per IPv4 interface
+struct InterfaceCounters
+{
+    static constexpr uint32_t mask = 1 << 3; //!< feature bit
+};
+
+/// Only record per-hop data for a deterministic subset of the packets
+struct Sampling
+{
+    static constexpr uint32_t mask = 1 << 4; //!< feature bit
+};
+
+/// Features of the original BigBrotherFlowProbe
+constexpr uint32_t DEFAULT_FEATURES = ProbeFlowStats::mask | PerHop::mask | Drops::mask;
+} // namespace bigbrother
+
 /// \ingroup flow-monitor
-/// \brief Class that tracks node-to-node metrics at the IPv4 layer of a Node
-class BigBrotherFlowProbe : public Ipv4FlowProbe
+/// \brief Configuration of the big-brother probes installed by FlowMonitorHelper
+///
+/// Its attributes select the features, hence the BigBrotherProbeImpl
+/// instantiation, of the probes.  They are set through
+/// FlowMonitorHelper::SetProbeAttribute, or as defaults with Config or the
+/// command line, e.g. --ns3::BigBrotherProbeConfig::SamplingRate=0.1
+class BigBrotherProbeConfig : public Object
+{
+public:
+    BigBrotherProbeConfig();
+    ~BigBrotherProbeConfig() override;
+
+    /// Register this type.
+    /// \return The TypeId.
+    static TypeId GetTypeId();
+
+    /// \returns the bigbrother feature bits selected by the attributes;
+    /// a SamplingRate below 1 adds bigbrother::Sampling
+    uint32_t GetFeatures() const;
+
+    /// \returns the fraction of packets whose hops are recorded
+    double GetSamplingRate() const;
+
+private:
+    bool m_probeFlowStats;    //!< update the FlowProbe stats
+    bool m_perHop;            //!< record every hop of every packet
+    bool m_drops;             //!< record drops per flow and per packet
+    bool m_interfaceCounters; //!< count packets per interface
+    double m_samplingRate;    //!< fraction of packets whose hops are recorded
+};
+
+/// \ingroup flow-monitor
+/// \brief Per-hop storage shared by the IPv4 and IPv6 big-brother probes
+///
+/// It owns the per-hop records read by the node-to-node analysis, while the
+/// BigBrotherProbeImpl template decides at compile time which of it gets
+/// updated.  Both address families use the same (FlowId, FlowPacketId) keys,
+/// since the classifiers of a FlowMonitor hand out FlowIds from one counter.
+class BigBrotherHopStore
 {
 public:
+    /// Per-hop record of a single packet at this probe
+    struct PacketStats
+    {
+        Time delayFromFirstProbe; //!< delay from the first probe up to this one
+        uint32_t bytes;           //!< size of the packet
+    };
+
+    /// Packet and byte counters of one interface of the node
+    struct InterfaceStats
+    {
+        uint64_t bytes = 0;          //!< bytes seen on the interface
+        uint32_t packets = 0;        //!< packets seen on the interface
+        uint32_t packetsDropped = 0; //!< packets dropped on the interface
+    };
+
+    /// A packet of a flow seen by this probe
+    struct Hop
+    {
+        FlowPacketId packetId; //!< the packet Identifier
+        PacketStats stats;     //!< per-hop record of the packet
+    };
+
     uint32_t m_nodeId; // Node ID of the node being monitored
-    // Container to map <FlowId, PacketId> -> map <NodeId, Stats>
-    typedef std::map<std::pair<FlowId, uint32_t>, FlowProbe::FlowStats> PerPacketStats;
-    PerPacketStats m_perPacketStats;
-    std::map<FlowId,uint32_t> m_packetStartIndex;
+    // Container to map FlowId -> hops of its packets, in the order they were seen
+    typedef std::unordered_map<FlowId, std::vector<Hop>> FlowHops;
+    FlowHops m_flowHops;
+    // Flows whose hops or drops this probe has seen, kept across the measurement windows
+    std::unordered_set<FlowId> m_seenFlows;
+    // Container to map <FlowId, PacketId> -> drop reason code
+    typedef std::map<std::pair<FlowId, FlowPacketId>, uint32_t> PerPacketDrops;
+    PerPacketDrops m_perPacketDrops;
+
+    /// \param nodeId the ID of the Node the probe is associated with
+    explicit BigBrotherHopStore(uint32_t nodeId);
+    virtual ~BigBrotherHopStore();
+
+    /// Set the fraction of packets whose hops are recorded.  Only used by
+    /// instantiations built with bigbrother::Sampling.  The decision only
+    /// depends on (flowId, packetId), so every probe samples the same packets.
+    /// \param rate sampling rate in [0, 1]
+    void SetSamplingRate(double rate);
+
+    /// \param flowId the flow Identifier
+    /// \param packetId the packet Identifier
+    /// \returns true if the hops of this packet are to be recorded
+    bool IsSampled(FlowId flowId, FlowPacketId packetId) const
+    {
+        uint64_t hash = ((static_cast<uint64_t>(flowId) << 32) | packetId) * 0x9E3779B97F4A7C15ULL;
+        return (hash >> 32) < m_samplingThreshold;
+    }
+
+    /// \returns the per-interface counters, indexed by interface
+    const std::vector<InterfaceStats>& GetInterfaceStats() const;
+
+    /// \returns the feature bits this probe was built with
+    virtual uint32_t GetFeatures() const = 0;
+
+    /// \param flowId the flow Identifier
+    /// \returns the hops of the flow's packets, in the order they were seen,
+    /// or nullptr if the probe never saw the flow
+    const std::vector<Hop>* GetFlowHops(FlowId flowId) const;
+
+    /// Clear the per-hop records: the lists of m_flowHops only hold the
+    /// packets of the current measurement window
+    void ClearPerPacketStats();
+
+    /// Drop the per-hop records of an evicted flow, and forget it was seen
+    /// \param flowId the flow Identifier
+    void ForgetFlowPackets(FlowId flowId);
+
+    /// \param probe any FlowProbe
+    /// \returns the per-hop store of the probe, or nullptr if it is not a
+    /// big-brother probe
+    static BigBrotherHopStore* Get(Ptr<FlowProbe> probe);
+
+protected:
+    /// Store the hop of a packet in m_flowHops
+    /// \param flowId the flow Identifier
+    /// \param packetId the packet Identifier
+    /// \param packetSize the packet size
+    /// \param delayFromFirstProbe packet delay
+    /// \returns true if it is the first hop or drop of the flow seen by this probe
+    bool RecordHop(FlowId flowId, FlowPacketId packetId, uint32_t packetSize, Time delayFromFirstProbe);
+    /// Store the drop of a packet in m_perPacketDrops
+    /// \param flowId the flow Identifier
+    /// \param packetId the packet Identifier
+    /// \param reasonCode reason code for the drop
+    /// \returns true if it is the first hop or drop of the flow seen by this probe
+    bool RecordDrop(FlowId flowId, FlowPacketId packetId, uint32_t reasonCode);
+    /// Count a packet on an interface
+    /// \param interface the interface, ignored if Ipv4::IF_ANY (same as Ipv6::IF_ANY)
+    /// \param packetSize the packet size
+    /// \param dropped whether the packet was dropped
+    void CountInterface(uint32_t interface, uint32_t packetSize, bool dropped);
+
+private:
+    uint64_t m_samplingThreshold; //!< IsSampled() accepts hashes below this value
+    std::vector<InterfaceStats> m_interfaceStats; //!< per-interface counters
+};
+
+/// \ingroup flow-monitor
+/// \brief Class that tracks node-to-node metrics at the IPv4 layer of a Node
+///
+/// This is the interface shared by all BasicBigBrotherProbe instantiations.
+class BigBrotherFlowProbe : public Ipv4FlowProbe, public BigBrotherHopStore
+{
+public:
+    /// Classifier type the probe is created with
+    typedef Ipv4FlowClassifier Classifier;
 
     BigBrotherFlowProbe(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier, Ptr<Node> node);
     ~BigBrotherFlowProbe() override;
 
-    // Add packet stats with additional node information
-    void AddPacketStats(FlowId flowId, uint32_t packetId, uint32_t packetSize, Time delayFromFirstProbe);
+    using FlowProbe::AddPacketStats;
+    using FlowProbe::AddPacketDropStats;
+
+    void ClearPerPacketStats() override;
 
     /// Register this type.
     /// \return The TypeId.
     static TypeId GetTypeId();
+};
+
+/// \ingroup flow-monitor
+/// \brief Class that tracks node-to-node metrics at the IPv6 layer of a Node
+///
+/// This is the interface shared by all Ipv6BasicBigBrotherProbe instantiations.
+class Ipv6BigBrotherFlowProbe : public Ipv6FlowProbe, public BigBrotherHopStore
+{
+public:
+    /// Classifier type the probe is created with
+    typedef Ipv6FlowClassifier Classifier;
+
+    Ipv6BigBrotherFlowProbe(Ptr<FlowMonitor> monitor,
+                            Ptr<Ipv6FlowClassifier> classifier,
+                            Ptr<Node> node);
+    ~Ipv6BigBrotherFlowProbe() override;
+
+    using FlowProbe::AddPacketStats;
+    using FlowProbe::AddPacketDropStats;
 
+    void ClearPerPacketStats() override;
+
+    /// Register this type.
+    /// \return The TypeId.
+    static TypeId GetTypeId();
 };
 
+/// \ingroup flow-monitor
+/// \brief Big-brother probe whose per-hop work is selected at compile time
+///
+/// Features not listed in the template arguments generate no code at all
+/// on the per-hop path, e.g. BasicBigBrotherProbe<bigbrother::PerHop> only
+/// fills m_flowHops and leaves the FlowProbe stats untouched.
+/// \tparam Probe BigBrotherFlowProbe or Ipv6BigBrotherFlowProbe
+/// \tparam Features bigbrother feature tags
+template <typename Probe, typename... Features>
+class BigBrotherProbeImpl : public Probe
+{
+public:
+    /// \param monitor the FlowMonitor this probe is associated with
+    /// \param classifier the flow classifier this probe is associated with
+    /// \param node the Node this probe is associated with
+    BigBrotherProbeImpl(Ptr<FlowMonitor> monitor,
+                        Ptr<typename Probe::Classifier> classifier,
+                        Ptr<Node> node)
+        : Probe(monitor, classifier, node)
+    {
+    }
+
+    /// \returns true if Feature is one of the template arguments
+    template <typename Feature>
+    static constexpr bool Has()
+    {
+        return (std::is_same_v<Feature, Features> || ...);
+    }
+
+    using FlowProbe::AddPacketStats;
+    using FlowProbe::AddPacketDropStats;
+
+    void AddPacketStats(FlowId flowId,
+                        FlowPacketId packetId,
+                        uint32_t packetSize,
+                        Time delayFromFirstProbe) override
+    {
+        if constexpr (Has<bigbrother::ProbeFlowStats>())
+        {
+            FlowProbe::AddPacketStats(flowId, packetSize, delayFromFirstProbe);
+        }
+        if constexpr (Has<bigbrother::InterfaceCounters>())
+        {
+            this->CountInterface(this->m_reportInterface, packetSize, false);
+        }
+        if constexpr (Has<bigbrother::PerHop>())
+        {
+            if constexpr (Has<bigbrother::Sampling>())
+            {
+                if (!this->IsSampled(flowId, packetId))
+                {
+                    return;
+                }
+            }
+            if (this->RecordHop(flowId, packetId, packetSize, delayFromFirstProbe))
+            {
+                this->m_flowMonitor->AddFlowObserver(flowId, this);
+            }
+        }
+    }
+
+    void AddPacketDropStats(FlowId flowId,
+                            FlowPacketId packetId,
+                            uint32_t packetSize,
+                            uint32_t reasonCode) override
+    {
+        if constexpr (Has<bigbrother::Drops>())
+        {
+            FlowProbe::AddPacketDropStats(flowId, packetSize, reasonCode);
+            // A flow whose packets are all dropped here is still evicted from this probe
+            if (this->RecordDrop(flowId, packetId, reasonCode))
+            {
+                this->m_flowMonitor->AddFlowObserver(flowId, this);
+            }
+        }
+        if constexpr (Has<bigbrother::InterfaceCounters>())
+        {
+            this->CountInterface(this->m_reportInterface, packetSize, true);
+        }
+    }
+
+    uint32_t GetFeatures() const override
+    {
+        return (Features::mask | ... | 0);
+    }
+};
+
+/// IPv4 big-brother probe built with the given features
+template <typename... Features>
+using BasicBigBrotherProbe = BigBrotherProbeImpl<BigBrotherFlowProbe, Features...>;
+
+/// IPv6 big-brother probe built with the given features
+template <typename... Features>
+using Ipv6BasicBigBrotherProbe = BigBrotherProbeImpl<Ipv6BigBrotherFlowProbe, Features...>;
+
+/// Instantiation equivalent to the original, do-everything BigBrotherFlowProbe
+typedef BasicBigBrotherProbe<bigbrother::ProbeFlowStats, bigbrother::PerHop, bigbrother::Drops>
+    FullBigBrotherProbe;
+
+/// Creates the BigBrotherProbeImpl instantiation matching a runtime set of
+/// feature bits.  Every combination of the listed features is instantiated,
+/// so the choice costs a handful of branches at install time only.
+/// \tparam Probe BigBrotherFlowProbe or Ipv6BigBrotherFlowProbe
+/// \tparam Selected features already chosen
+/// \tparam Remaining features still to be decided
+template <typename Probe, typename Selected, typename Remaining>
+struct BigBrotherProbeFactory;
+
+/// \cond
+template <typename... Features>
+struct BigBrotherFeatureList
+{
+};
+
+template <typename Probe, typename... Selected>
+struct BigBrotherProbeFactory<Probe, BigBrotherFeatureList<Selected...>, BigBrotherFeatureList<>>
+{
+    static Ptr<Probe> Create(uint32_t features,
+                             Ptr<FlowMonitor> monitor,
+                             Ptr<typename Probe::Classifier> classifier,
+                             Ptr<Node> node)
+    {
+        return ns3::Create<BigBrotherProbeImpl<Probe, Selected...>>(monitor, classifier, node);
+    }
+};
+
+template <typename Probe, typename... Selected, typename Next, typename... Rest>
+struct BigBrotherProbeFactory<Probe,
+                              BigBrotherFeatureList<Selected...>,
+                              BigBrotherFeatureList<Next, Rest...>>
+{
+    static Ptr<Probe> Create(uint32_t features,
+                             Ptr<FlowMonitor> monitor,
+                             Ptr<typename Probe::Classifier> classifier,
+                             Ptr<Node> node)
+    {
+        if (features & Next::mask)
+        {
+            return BigBrotherProbeFactory<Probe,
+                                          BigBrotherFeatureList<Selected..., Next>,
+                                          BigBrotherFeatureList<Rest...>>::Create(features,
+                                                                                  monitor,
+                                                                                  classifier,
+                                                                                  node);
+        }
+        return BigBrotherProbeFactory<Probe,
+                                      BigBrotherFeatureList<Selected...>,
+                                      BigBrotherFeatureList<Rest...>>::Create(features,
+                                                                              monitor,
+                                                                              classifier,
+                                                                              node);
+    }
+};
+/// \endcond
+
+/// \param features bitwise or of bigbrother::*::mask values
+/// \param monitor the FlowMonitor the probe is associated with
+/// \param classifier the Ipv4FlowClassifier the probe is associated with
+/// \param node the Node the probe is associated with
+/// \returns a probe compiled with exactly the requested features
+Ptr<BigBrotherFlowProbe> CreateBigBrotherFlowProbe(uint32_t features,
+                                                   Ptr<FlowMonitor> monitor,
+                                                   Ptr<Ipv4FlowClassifier> classifier,
+                                                   Ptr<Node> node);
+
+/// \param features bitwise or of bigbrother::*::mask values
+/// \param monitor the FlowMonitor the probe is associated with
+/// \param classifier the Ipv6FlowClassifier the probe is associated with
+/// \param node the Node the probe is associated with
+/// \returns a probe compiled with exactly the requested features
+Ptr<Ipv6BigBrotherFlowProbe> CreateIpv6BigBrotherFlowProbe(uint32_t features,
+                                                           Ptr<FlowMonitor> monitor,
+                                                           Ptr<Ipv6FlowClassifier> classifier,
+                                                           Ptr<Node> node);
+
 } // namespace ns3
 
-#endif /* BIG_BROTHER_FLOW_PROBE_H */
\ No newline at end of file
+#endif /* BIG_BROTHER_FLOW_PROBE_H */
@@ -0,0 +1,210 @@
+// flow-anomaly-detector.cc
+#include "flow-anomaly-detector.h"
+
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("FlowAnomalyDetector");
+
+NS_OBJECT_ENSURE_REGISTERED(FlowAnomalyDetector);
+
+TypeId
+FlowAnomalyDetector::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::FlowAnomalyDetector")
+            .SetParent<Object>()
+            .SetGroupName("FlowMonitor")
+            .AddConstructor<FlowAnomalyDetector>()
+            .AddAttribute("Alpha",
+                          ("Weight of a new measurement in the moving average and "
+                           "variance of its flow."),
+                          DoubleValue(0.2),
+                          MakeDoubleAccessor(&FlowAnomalyDetector::m_alpha),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("ZScoreLimit",
+                          ("Deviation from the baseline, in standard deviations, "
+                           "that is an anomaly."),
+                          DoubleValue(3),
+                          MakeDoubleAccessor(&FlowAnomalyDetector::m_zScoreLimit),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("RelativeThroughputLimit",
+                          ("Decrease of the throughput, relative to the baseline, that "
+                           "is an anomaly."),
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&FlowAnomalyDetector::m_throughputLimit),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("RelativeDelayLimit",
+                          ("Increase of the delay, relative to the baseline, that is "
+                           "an anomaly."),
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&FlowAnomalyDetector::m_delayLimit),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("RelativeJitterLimit",
+                          ("Increase of the jitter, relative to the baseline, that is "
+                           "an anomaly."),
+                          DoubleValue(1),
+                          MakeDoubleAccessor(&FlowAnomalyDetector::m_jitterLimit),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("StdDevFloor",
+                          ("Floor of the standard deviation of the z-scores, relative "
+                           "to the mean."),
+                          DoubleValue(0.05),
+                          MakeDoubleAccessor(&FlowAnomalyDetector::m_stdDevFloor),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("MinSamples",
+                          ("Measurements a KPI of a flow learns before it is checked."),
+                          UintegerValue(5),
+                          MakeUintegerAccessor(&FlowAnomalyDetector::m_minSamples),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("RelearnIntervals",
+                          ("Consecutive anomalous measurements of a KPI after which its "
+                           "baseline is learned again from the last one.  Zero keeps the "
+                           "baseline."),
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&FlowAnomalyDetector::m_relearnIntervals),
+                          MakeUintegerChecker<uint32_t>());
+    return tid;
+}
+
+FlowAnomalyDetector::FlowAnomalyDetector()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+FlowAnomalyDetector::~FlowAnomalyDetector()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+FlowAnomalyDetector::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    m_baselines.clear();
+    Object::DoDispose();
+}
+
+const char*
+FlowAnomalyDetector::GetKpiName(Kpi kpi)
+{
+    switch (kpi)
+    {
+    case THROUGHPUT:
+        return "throughput";
+    case DELAY:
+        return "delay";
+    case JITTER:
+        return "jitter";
+    default:
+        return "unknown";
+    }
+}
+
+uint32_t
+FlowAnomalyDetector::GetSamples(FlowId flowId, Kpi kpi) const
+{
+    auto baseline = m_baselines.find(flowId);
+    return baseline == m_baselines.end() ? 0 : baseline->second.samples[kpi];
+}
+
+void
+FlowAnomalyDetector::ForgetFlow(FlowId flowId)
+{
+    NS_LOG_FUNCTION(this << flowId);
+    m_baselines.erase(flowId);
+}
+
+FlowAnomalyDetector::Deviation
+FlowAnomalyDetector::Check(const FlowBaseline& baseline, Kpi kpi, double value) const
+{
+    Deviation deviation;
+    deviation.value = value;
+    deviation.measured = true;
+    deviation.mean = baseline.kpis[kpi].mean;
+    if (baseline.samples[kpi] < m_minSamples)
+    {
+        return deviation;
+    }
+
+    // A lower throughput degrades the flow, a higher delay or jitter too
+    double mean = baseline.kpis[kpi].mean;
+    double degradation = kpi == THROUGHPUT ? mean - value : value - mean;
+    double stdDev = std::max(std::sqrt(baseline.kpis[kpi].variance), m_stdDevFloor * mean);
+    deviation.zScore = stdDev > 0 ? degradation / stdDev : 0;
+    deviation.relative = mean > 0 ? degradation / mean : 0;
+
+    const double relativeLimits[N_KPIS] = {m_throughputLimit, m_delayLimit, m_jitterLimit};
+    deviation.anomalous =
+        degradation > 0 &&
+        (deviation.zScore >= m_zScoreLimit || deviation.relative >= relativeLimits[kpi]);
+    return deviation;
+}
+
+FlowAnomalyDetector::Result
+FlowAnomalyDetector::DoUpdate(FlowId flowId, const double values[N_KPIS], uint32_t nKpis)
+{
+    FlowBaseline& baseline = m_baselines[flowId];
+    Result result;
+    for (uint32_t k = 0; k < nKpis; k++)
+    {
+        Kpi kpi = static_cast<Kpi>(k);
+        Deviation& deviation = result.kpis[kpi];
+        deviation = Check(baseline, kpi, values[kpi]);
+        if (deviation.anomalous)
+        {
+            NS_LOG_DEBUG("Flow " << flowId << " " << GetKpiName(kpi) << " " << deviation.value
+                                 << " against " << deviation.mean << " (z " << deviation.zScore
+                                 << ", " << deviation.relative * 100 << "%)");
+            result.anomalous = true;
+            if (m_relearnIntervals == 0 || ++baseline.anomalous[kpi] < m_relearnIntervals)
+            {
+                continue;
+            }
+            // The level has shifted for good: it becomes the new baseline
+            NS_LOG_DEBUG("Flow " << flowId << " " << GetKpiName(kpi) << " learned again after "
+                                 << baseline.anomalous[kpi] << " anomalies");
+            baseline.kpis[kpi] = Baseline();
+            baseline.samples[kpi] = 0;
+        }
+        baseline.anomalous[kpi] = 0;
+
+        // Incremental EWMA and EWMV; the first measurement sets the mean
+        Baseline& kpiBaseline = baseline.kpis[kpi];
+        if (baseline.samples[kpi]++ == 0)
+        {
+            kpiBaseline.mean = values[kpi];
+            continue;
+        }
+        double difference = values[kpi] - kpiBaseline.mean;
+        double increment = m_alpha * difference;
+        kpiBaseline.mean += increment;
+        kpiBaseline.variance = (1 - m_alpha) * (kpiBaseline.variance + difference * increment);
+    }
+    return result;
+}
+
+FlowAnomalyDetector::Result
+FlowAnomalyDetector::Update(FlowId flowId, double throughput, Time delay, Time jitter)
+{
+    NS_LOG_FUNCTION(this << flowId << throughput << delay << jitter);
+    const double values[N_KPIS] = {throughput, delay.GetSeconds(), jitter.GetSeconds()};
+    return DoUpdate(flowId, values, N_KPIS);
+}
+
+FlowAnomalyDetector::Result
+FlowAnomalyDetector::Update(FlowId flowId, double throughput)
+{
+    NS_LOG_FUNCTION(this << flowId << throughput);
+    const double values[N_KPIS] = {throughput, 0, 0};
+    return DoUpdate(flowId, values, THROUGHPUT + 1);
+}
+
+} // namespace ns3
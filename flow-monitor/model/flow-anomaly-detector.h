@@ -0,0 +1,147 @@
+// flow-anomaly-detector.h
+#ifndef FLOW_ANOMALY_DETECTOR_H
+#define FLOW_ANOMALY_DETECTOR_H
+
+#include "flow-classifier.h"
+
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <unordered_map>
+
+namespace ns3
+{
+
+/// \ingroup flow-monitor
+/// \brief Detects the degraded flows against a baseline of each flow
+///
+/// Every flow has its own baseline of its throughput, delay and jitter: an
+/// exponentially weighted moving average and variance (EWMA/EWMV), with
+/// weight Alpha for the new measurement.  Once a KPI of a flow has learned
+/// MinSamples measurements, it is anomalous when its deviation from the
+/// baseline, in the degrading direction (a lower throughput, a higher delay
+/// or jitter), is at least ZScoreLimit standard deviations or the
+/// Relative*Limit of the mean.
+///
+/// The standard deviation is floored at StdDevFloor times the mean, so the
+/// z-score of a flow at a constant rate doesn't alarm on the smallest change.
+/// Anomalous measurements are not fed to the baseline, so a flow that stays
+/// degraded stays anomalous, for up to RelearnIntervals consecutive
+/// intervals: then the level of the KPI is taken as its new normal, and its
+/// baseline is learned again from the last measurement.
+///
+/// An update costs O(1) per flow.
+class FlowAnomalyDetector : public Object
+{
+public:
+    /// KPIs of a flow
+    enum Kpi
+    {
+        THROUGHPUT = 0, //!< received bit rate, in Mbps
+        DELAY,          //!< mean delay, in seconds
+        JITTER,         //!< mean jitter, in seconds
+        N_KPIS          //!< number of KPIs
+    };
+
+    /// Deviation of a KPI from the baseline of its flow
+    struct Deviation
+    {
+        double value = 0;       //!< measured value
+        double mean = 0;        //!< baseline mean, before the measurement
+        double zScore = 0;      //!< deviation in standard deviations, positive if degrading
+        double relative = 0;    //!< deviation relative to the mean, positive if degrading
+        bool measured = false;  //!< the KPI was measured
+        bool anomalous = false; //!< the deviation crosses a limit
+    };
+
+    /// Outcome of an update of a flow
+    struct Result
+    {
+        Deviation kpis[N_KPIS]; //!< deviation of every KPI
+        bool anomalous = false; //!< any KPI is anomalous
+    };
+
+    FlowAnomalyDetector();
+    ~FlowAnomalyDetector() override;
+
+    /// Register this type.
+    /// \return The TypeId.
+    static TypeId GetTypeId();
+
+    /// \brief Check the measurements of a flow over an interval, and learn the
+    /// ones that are not anomalous
+    /// \param flowId the flow
+    /// \param throughput the received bit rate, in Mbps
+    /// \param delay the mean delay of the received packets
+    /// \param jitter the mean jitter of the received packets
+    /// \returns the deviations from the baseline
+    Result Update(FlowId flowId, double throughput, Time delay, Time jitter);
+
+    /// \brief Check the throughput of a flow that received no packet over an
+    /// interval, so without a delay or a jitter
+    /// \param flowId the flow
+    /// \param throughput the received bit rate, in Mbps
+    /// \returns the deviations from the baseline
+    Result Update(FlowId flowId, double throughput);
+
+    /// \param flowId a flow
+    /// \param kpi a KPI
+    /// \returns the number of measurements learned by the baseline of the KPI
+    uint32_t GetSamples(FlowId flowId, Kpi kpi) const;
+
+    /// \brief Release the baseline of a flow, e.g. when the monitor evicts it
+    /// \param flowId the flow
+    void ForgetFlow(FlowId flowId);
+
+    /// \param kpi a KPI
+    /// \returns the name of the KPI
+    static const char* GetKpiName(Kpi kpi);
+
+protected:
+    void DoDispose() override;
+
+private:
+    /// EWMA/EWMV of a KPI
+    struct Baseline
+    {
+        double mean = 0;     //!< moving average
+        double variance = 0; //!< moving variance
+    };
+
+    /// Baseline of a flow
+    struct FlowBaseline
+    {
+        Baseline kpis[N_KPIS];        //!< baseline of every KPI
+        uint32_t samples[N_KPIS]{};   //!< measurements learned by every KPI
+        uint32_t anomalous[N_KPIS]{}; //!< consecutive anomalous measurements of every KPI
+    };
+
+    /// \brief Check a KPI against its baseline
+    /// \param baseline the baseline of the flow
+    /// \param kpi the KPI
+    /// \param value the measured value
+    /// \returns the deviation from the baseline
+    Deviation Check(const FlowBaseline& baseline, Kpi kpi, double value) const;
+
+    /// \brief Check the measured KPIs of a flow and learn the ones that are not anomalous
+    /// \param flowId the flow
+    /// \param values the value of every KPI
+    /// \param nKpis number of KPIs measured, from THROUGHPUT
+    /// \returns the deviations from the baseline
+    Result DoUpdate(FlowId flowId, const double values[N_KPIS], uint32_t nKpis);
+
+    double m_alpha;                  //!< weight of a new measurement in the baseline
+    double m_zScoreLimit;            //!< z-score of an anomaly
+    double m_throughputLimit;        //!< relative throughput decrease of an anomaly
+    double m_delayLimit;             //!< relative delay increase of an anomaly
+    double m_jitterLimit;            //!< relative jitter increase of an anomaly
+    double m_stdDevFloor;            //!< floor of the standard deviation, relative to the mean
+    uint32_t m_minSamples;           //!< measurements learned by a KPI before its checks
+    uint32_t m_relearnIntervals;     //!< consecutive anomalies after which a KPI is learned again
+
+    std::unordered_map<FlowId, FlowBaseline> m_baselines; //!< FlowId --> baseline
+};
+
+} // namespace ns3
+
+#endif /* FLOW_ANOMALY_DETECTOR_H */
@@ -19,11 +19,13 @@
 
 #include "flow-classifier.h"
 
+#include "ns3/abort.h"
+
 namespace ns3
 {
 
 FlowClassifier::FlowClassifier()
-    : m_lastNewFlowId(0)
+    : m_flowIdCounter(Create<FlowIdCounter>())
 {
 }
 
@@ -34,7 +36,26 @@ FlowClassifier::~FlowClassifier()
 FlowId
 FlowClassifier::GetNewFlowId()
 {
-    return ++m_lastNewFlowId;
+    return ++m_flowIdCounter->m_lastFlowId;
+}
+
+void
+FlowClassifier::SetFlowIdCounter(Ptr<FlowIdCounter> counter)
+{
+    NS_ABORT_MSG_IF(counter != m_flowIdCounter && m_flowIdCounter->m_lastFlowId != 0,
+                    "The classifier already handed out FlowIds from another counter");
+    m_flowIdCounter = counter;
+}
+
+bool
+FlowClassifier::WriteFlowKey(std::ostream& os, FlowId flowId) const
+{
+    return false;
+}
+
+void
+FlowClassifier::ForgetFlow(FlowId flowId)
+{
 }
 
 } // namespace ns3
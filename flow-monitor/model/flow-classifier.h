@@ -20,6 +20,7 @@
 #ifndef FLOW_CLASSIFIER_H
 #define FLOW_CLASSIFIER_H
 
+#include "ns3/ptr.h"
 #include "ns3/simple-ref-count.h"
 
 #include <ostream>
@@ -39,6 +40,15 @@ typedef uint32_t FlowId;
  */
 typedef uint32_t FlowPacketId;
 
+/// \ingroup flow-monitor
+/// Last FlowId handed out by the classifiers sharing it.  A FlowMonitor
+/// shares its counter with all its classifiers, so their flows never collide.
+class FlowIdCounter : public SimpleRefCount<FlowIdCounter>
+{
+  public:
+    FlowId m_lastFlowId = 0; //!< last FlowId handed out
+};
+
 /// \ingroup flow-monitor
 /// Provides a method to translate raw packet data into abstract
 /// `flow identifier` and `packet identifier` parameters.  These
@@ -52,9 +62,6 @@ typedef uint32_t FlowPacketId;
 /// particular flow capture method or classification system.
 class FlowClassifier : public SimpleRefCount<FlowClassifier>
 {
-  private:
-    FlowId m_lastNewFlowId; //!< Last known Flow ID
-
   public:
     FlowClassifier();
     virtual ~FlowClassifier();
@@ -68,8 +75,28 @@ class FlowClassifier : public SimpleRefCount<FlowClassifier>
     /// \param indent number of spaces to use as base indentation level
     virtual void SerializeToXmlStream(std::ostream& os, uint16_t indent) const = 0;
 
+    /// Write the key of a flow as comma-separated fields: source address,
+    /// destination address, protocol, source port and destination port.
+    /// \param os the output stream
+    /// \param flowId the flow identifier
+    /// \returns false if the flow is not known by this classifier
+    virtual bool WriteFlowKey(std::ostream& os, FlowId flowId) const;
+
+    /// Release the state kept for a flow that is not expected to send again.
+    /// A later packet of the same flow is classified into a new FlowId.
+    /// \param flowId the flow identifier
+    virtual void ForgetFlow(FlowId flowId);
+
+    /// Hand out the FlowIds from a counter shared with other classifiers.
+    /// FlowMonitor::AddFlowClassifier sets its own counter, which must
+    /// happen before the classifier sees its first flow.
+    /// \param counter the shared counter
+    void SetFlowIdCounter(Ptr<FlowIdCounter> counter);
+
   protected:
-    /// Returns a new, unique Flow Identifier
+    /// Returns a new, unique Flow Identifier.  The identifiers are shared
+    /// by all the classifiers of a FlowMonitor, so IPv4 and IPv6 flows never
+    /// collide, and start from 1 in every monitor.
     /// \returns a new FlowId
     FlowId GetNewFlowId();
 
@@ -78,6 +105,9 @@ class FlowClassifier : public SimpleRefCount<FlowClassifier>
     /// \param os The stream to write to.
     /// \param level The number of spaces to add.
     void Indent(std::ostream& os, uint16_t level) const;
+
+  private:
+    Ptr<FlowIdCounter> m_flowIdCounter; //!< source of the FlowIds
 };
 
 inline void
@@ -427,6 +427,12 @@ FlowMonitor::AddFlowClassifier(Ptr<FlowClassifier> classifier)
     m_classifiers.push_back(classifier);
 }
 
+const std::list<Ptr<FlowClassifier>>&
+FlowMonitor::GetFlowClassifiers() const
+{
+    return m_classifiers;
+}
+
 void
 FlowMonitor::SerializeToXmlStream(std::ostream& os,
                                   uint16_t indent,
@@ -28,8 +28,13 @@
 #include "ns3/nstime.h"
 #include "ns3/object.h"
 #include "ns3/ptr.h"
+#include "ns3/traced-callback.h"
 
+#include <fstream>
 #include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace ns3
@@ -138,6 +143,53 @@ class FlowMonitor : public Object
         Histogram flowInterruptionsHistogram; //!< histogram of durations of flow interruptions
     };
 
+    /// \brief Flow-level event, carried by the FlowStarted, FlowIdle and FlowEvicted traces
+    struct FlowEvent
+    {
+        FlowId flowId; //!< flow identification
+        Time lastSeen; //!< time of the last packet sent by the flow
+    };
+
+    /// \brief Packet declared lost by CheckForLostPackets, carried by the PacketLost trace
+    struct PacketLostEvent
+    {
+        FlowId flowId;         //!< flow identification
+        FlowPacketId packetId; //!< packet identification
+        Time lastSeen;         //!< last time a probe saw the packet
+    };
+
+    /// \brief Delay threshold crossing, carried by the ThresholdCrossed trace
+    struct ThresholdEvent
+    {
+        FlowId flowId;         //!< flow identification
+        FlowPacketId packetId; //!< packet whose delay crossed the threshold
+        Time delay;            //!< end-to-end delay of the packet
+        bool above;            //!< true when going above the threshold, false when going back below
+    };
+
+    /// \brief Packet drop reported by a probe, carried by the DropObserved trace
+    struct DropEvent
+    {
+        FlowId flowId;         //!< flow identification
+        FlowPacketId packetId; //!< packet identification
+        uint32_t packetSize;   //!< packet size
+        uint32_t reasonCode;   //!< probe-specific drop reason code
+        const FlowProbe* probe; //!< the reporting probe
+    };
+
+    /// TracedCallback signature for FlowEvent.
+    /// \param [in] event the event
+    typedef void (*FlowEventTracedCallback)(const FlowEvent& event);
+    /// TracedCallback signature for PacketLostEvent.
+    /// \param [in] event the event
+    typedef void (*PacketLostTracedCallback)(const PacketLostEvent& event);
+    /// TracedCallback signature for ThresholdEvent.
+    /// \param [in] event the event
+    typedef void (*ThresholdTracedCallback)(const ThresholdEvent& event);
+    /// TracedCallback signature for DropEvent.
+    /// \param [in] event the event
+    typedef void (*DropTracedCallback)(const DropEvent& event);
+
     // --- basic methods ---
     /**
      * \brief Get the type ID.
@@ -147,10 +199,14 @@ class FlowMonitor : public Object
     TypeId GetInstanceTypeId() const override;
     FlowMonitor();
 
-    /// Add a FlowClassifier to be used by the flow monitor.
+    /// Add a FlowClassifier to be used by the flow monitor.  The classifiers
+    /// of a monitor hand out their FlowIds from the monitor's counter.
     /// \param classifier the FlowClassifier
     void AddFlowClassifier(Ptr<FlowClassifier> classifier);
 
+    /// \returns the FlowClassifiers of the monitor, in the order they were added
+    const std::list<Ptr<FlowClassifier>>& GetFlowClassifiers() const;
+
     /// Set the time, counting from the current time, from which to start monitoring flows.
     /// This method overwrites any previous calls to Start()
     /// \param time delta time to start
@@ -216,6 +272,20 @@ class FlowMonitor : public Object
                     uint32_t packetSize,
                     uint32_t reasonCode);
 
+    /// Per-hop probes are supposed to call this method the first time they
+    /// record a hop of a flow, so the probes observing each flow are indexed.
+    /// \param flowId flow identification
+    /// \param probe the probe that saw the flow
+    void AddFlowObserver(FlowId flowId, Ptr<FlowProbe> probe);
+
+    /// Probes that see a packet without reporting it (e.g., NrFlowProbe) use
+    /// this method to time their sighting like the other hops.
+    /// \param flowId flow identification
+    /// \param packetId Packet ID
+    /// \param delay filled with the time since the first probe saw the packet
+    /// \returns false if the packet is not in flight
+    bool GetDelayFromFirstProbe(FlowId flowId, FlowPacketId packetId, Time* delay) const;
+
     /// Check right now for packets that appear to be lost
     void CheckForLostPackets();
 
@@ -244,13 +314,44 @@ class FlowMonitor : public Object
     /// FlowMonitor has not stopped monitoring yet, you should call
     /// CheckForLostPackets() to make sure all possibly lost packets are
     /// accounted for.
+    ///
+    /// The statistics are not copied: the reference reflects the packets
+    /// seen until the simulation goes on, and ResetAllStats() or the
+    /// eviction of idle flows change it.  Copy the container to keep a
+    /// snapshot.
     /// \returns the flows statistics
     const FlowStatsContainer& GetFlowStats() const;
 
+    /// Hot counters of the flows, stored column by column (structure of
+    /// arrays): row i of every column is the same flow.  Network-wide
+    /// aggregates are then contiguous, vectorizable loops instead of a walk
+    /// of the FlowStatsContainer nodes.  The rows follow the order the flows
+    /// were first seen in, and an evicted flow's row is replaced by the last
+    /// one.
+    struct HotCounters
+    {
+        std::vector<FlowId> flowId;      //!< flow of every row
+        std::vector<uint64_t> rxBytes;   //!< FlowStats::rxBytes
+        std::vector<uint32_t> rxPackets; //!< FlowStats::rxPackets
+        std::vector<int64_t> delaySum;   //!< FlowStats::delaySum, in nanoseconds
+        std::vector<int64_t> jitterSum;  //!< FlowStats::jitterSum, in nanoseconds
+        std::vector<int64_t> lastDelay;  //!< FlowStats::lastDelay, in nanoseconds
+    };
+
+    /// Get the hot counters of all the flows, same values as GetFlowStats()
+    /// \returns the hot counters, valid until the simulation goes on
+    const HotCounters& GetHotCounters() const;
+
     /// Get a list of all FlowProbe's associated with this FlowMonitor
     /// \returns a list of all the probes
     const FlowProbeContainer& GetAllProbes() const;
 
+    /// Get the probes that recorded hops of a flow, so a path can be rebuilt
+    /// without visiting the probes that never carried it
+    /// \param flowId the Flow identification
+    /// \returns the probes, in the order they first saw the flow
+    const FlowProbeContainer& GetFlowObservers(FlowId flowId) const;
+
     /// Serializes the results to an std::ostream in XML format
     /// \param os the output stream
     /// \param indent number of spaces to use as base indentation level
@@ -277,6 +378,16 @@ class FlowMonitor : public Object
     /// Reset all the statistics
     void ResetAllStats();
 
+    /// Retire the flows that neither sent nor received for longer than
+    /// idleTimeout and have no packet in flight.  Their lifetime stats, over
+    /// every ResetAllStats() window, are appended to FlowArchiveFile, if set,
+    /// and their state is released from the monitor, the classifiers and the
+    /// probes.  FlowEvicted is fired for every evicted flow.
+    /// This is done periodically when FlowEvictionTimeout is set.
+    /// \param idleTimeout the inactivity after which a flow is evicted
+    /// \returns the number of flows evicted
+    uint32_t EvictIdleFlows(Time idleTimeout);
+
   protected:
     void NotifyConstructionCompleted() override;
     void DoDispose() override;
@@ -290,17 +401,38 @@ class FlowMonitor : public Object
         uint32_t timesForwarded; //!< number of times the packet was reportedly forwarded
     };
 
+    /// Counters of a flow summed over the windows closed by ResetAllStats()
+    struct FlowTotals
+    {
+        Time timeFirstTxPacket;      //!< first transmission of the flow
+        Time timeFirstRxPacket;      //!< first reception of the flow
+        Time delaySum;               //!< sum of the delays of the received packets
+        Time jitterSum;              //!< sum of the jitters of the received packets
+        uint64_t txBytes = 0;        //!< bytes transmitted
+        uint64_t rxBytes = 0;        //!< bytes received
+        uint32_t txPackets = 0;      //!< packets transmitted
+        uint32_t rxPackets = 0;      //!< packets received
+        uint32_t lostPackets = 0;    //!< packets lost
+        uint32_t timesForwarded = 0; //!< times the packets were forwarded
+    };
+
     /// FlowId --> FlowStats
     FlowStatsContainer m_flowStats;
+    /// FlowId --> totals of the closed windows, only kept with a FlowArchiveFile
+    std::unordered_map<FlowId, FlowTotals> m_flowTotals;
+    HotCounters m_hotCounters;                      //!< hot counters of m_flowStats
+    std::unordered_map<FlowId, uint32_t> m_hotRows; //!< FlowId --> row in m_hotCounters
 
     /// (FlowId,PacketId) --> TrackedPacket
     typedef std::map<std::pair<FlowId, FlowPacketId>, TrackedPacket> TrackedPacketMap;
     TrackedPacketMap m_trackedPackets; //!< Tracked packets
     Time m_maxPerHopDelay;             //!< Minimum per-hop delay
     FlowProbeContainer m_flowProbes;   //!< all the FlowProbes
+    std::unordered_map<FlowId, FlowProbeContainer> m_flowObservers; //!< FlowId --> probes that saw it
 
     // note: this is needed only for serialization
     std::list<Ptr<FlowClassifier>> m_classifiers; //!< the FlowClassifiers
+    Ptr<FlowIdCounter> m_flowIdCounter;           //!< FlowIds of the classifiers
 
     EventId m_startEvent;               //!< Start event
     EventId m_stopEvent;                //!< Stop event
@@ -310,14 +442,55 @@ class FlowMonitor : public Object
     double m_packetSizeBinWidth;        //!< packet size bin width (for histograms)
     double m_flowInterruptionsBinWidth; //!< Flow interruptions bin width (for histograms)
     Time m_flowInterruptionsMinTime;    //!< Flow interruptions minimum time
+    Time m_flowIdleTimeout;             //!< Inactivity after which a flow is idle
+    Time m_delayThreshold;              //!< Delay checked by ThresholdCrossed, zero to disable
+    Time m_flowEvictionTimeout;         //!< Inactivity after which a flow is evicted, zero to disable
+    std::string m_archiveFileName;      //!< File the evicted flows are appended to
+    std::string m_archiveFormat;        //!< Format of the archive, "csv" or "binary"
+    std::ofstream m_archive;            //!< Archive stream, opened on the first eviction
+
+    std::unordered_map<FlowId, EventId> m_idleTimers; //!< FlowIdle timers of the transmitting flows
+    std::set<FlowId> m_flowsAboveThreshold; //!< flows whose last delay was above m_delayThreshold
+
+    TracedCallback<const FlowEvent&> m_flowStartedTrace;     //!< FlowStarted trace source
+    TracedCallback<const FlowEvent&> m_flowIdleTrace;        //!< FlowIdle trace source
+    TracedCallback<const FlowEvent&> m_flowEvictedTrace;     //!< FlowEvicted trace source
+    TracedCallback<const PacketLostEvent&> m_packetLostTrace; //!< PacketLost trace source
+    TracedCallback<const ThresholdEvent&> m_thresholdTrace;   //!< ThresholdCrossed trace source
+    TracedCallback<const DropEvent&> m_dropTrace;             //!< DropObserved trace source
 
     /// Get the stats for a given flow
     /// \param flowId the Flow identification
     /// \returns the stats of the flow
     FlowStats& GetStatsForFlow(FlowId flowId);
 
+    /// Copy the hot counters of a flow to its row of m_hotCounters
+    /// \param flowId the Flow identification
+    /// \param stats the stats of the flow
+    void UpdateHotCounters(FlowId flowId, const FlowStats& stats);
+
+    /// Remove the row of an evicted flow from m_hotCounters
+    /// \param flowId the Flow identification
+    void RemoveHotCounters(FlowId flowId);
+
     /// Periodic function to check for lost packets and prune statistics
     void PeriodicCheckForLostPackets();
+
+    /// Fire FlowIdle if the flow has been silent for m_flowIdleTimeout,
+    /// otherwise restart its timer from its last transmission
+    /// \param flowId the Flow identification
+    void CheckForIdleFlow(FlowId flowId);
+
+    /// Add the counters of a window of a flow to its totals
+    /// \param totals the totals of the flow
+    /// \param stats the stats of the flow since the last ResetAllStats()
+    static void AddToTotals(FlowTotals& totals, const FlowStats& stats);
+
+    /// Append the lifetime stats of an evicted flow to the archive: its totals
+    /// of the closed windows plus its stats since the last ResetAllStats()
+    /// \param flowId the Flow identification
+    /// \param stats the stats of the flow since the last ResetAllStats()
+    void ArchiveFlow(FlowId flowId, const FlowStats& stats);
 };
 
 } // namespace ns3
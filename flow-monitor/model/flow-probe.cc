@@ -75,12 +75,41 @@ FlowProbe::AddPacketDropStats(FlowId flowId, uint32_t packetSize, uint32_t reaso
     flow.bytesDropped[reasonCode] += packetSize;
 }
 
-FlowProbe::Stats
+void
+FlowProbe::AddPacketStats(FlowId flowId,
+                          FlowPacketId packetId,
+                          uint32_t packetSize,
+                          Time delayFromFirstProbe)
+{
+    AddPacketStats(flowId, packetSize, delayFromFirstProbe);
+}
+
+void
+FlowProbe::AddPacketDropStats(FlowId flowId,
+                              FlowPacketId packetId,
+                              uint32_t packetSize,
+                              uint32_t reasonCode)
+{
+    AddPacketDropStats(flowId, packetSize, reasonCode);
+}
+
+const FlowProbe::Stats&
 FlowProbe::GetStats() const
 {
     return m_stats;
 }
 
+void
+FlowProbe::ForgetFlow(FlowId flowId)
+{
+    m_stats.erase(flowId);
+}
+
+void
+FlowProbe::ClearPerPacketStats()
+{
+}
+
 void
 FlowProbe::SerializeToXmlStream(std::ostream& os, uint16_t indent, uint32_t index) const
 {
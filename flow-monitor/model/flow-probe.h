@@ -93,11 +93,44 @@ class FlowProbe : public Object
     /// \param reasonCode reason code for the drop
     void AddPacketDropStats(FlowId flowId, uint32_t packetSize, uint32_t reasonCode);
 
+    /// Add a packet data to the flow stats, identifying the packet
+    /// within its flow.  This is the entry point used by the FlowMonitor;
+    /// the default implementation ignores the packet identifier.
+    /// \param flowId the flow Identifier
+    /// \param packetId the packet Identifier
+    /// \param packetSize the packet size
+    /// \param delayFromFirstProbe packet delay
+    virtual void AddPacketStats(FlowId flowId,
+                                FlowPacketId packetId,
+                                uint32_t packetSize,
+                                Time delayFromFirstProbe);
+    /// Add a packet drop data to the flow stats, identifying the packet
+    /// within its flow.  This is the entry point used by the FlowMonitor;
+    /// the default implementation ignores the packet identifier.
+    /// \param flowId the flow Identifier
+    /// \param packetId the packet Identifier
+    /// \param packetSize the packet size
+    /// \param reasonCode reason code for the drop
+    virtual void AddPacketDropStats(FlowId flowId,
+                                    FlowPacketId packetId,
+                                    uint32_t packetSize,
+                                    uint32_t reasonCode);
+
     /// Get the partial flow statistics stored in this probe.  With this
     /// information you can, for example, find out what is the delay
     /// from the first probe to this one.
-    /// \returns the partial flow statistics
-    Stats GetStats() const;
+    /// \returns the partial flow statistics, valid until the simulation
+    /// goes on; copy them to keep a snapshot
+    const Stats& GetStats() const;
+
+    /// Release the stats of a flow evicted by the FlowMonitor
+    /// \param flowId the flow Identifier
+    virtual void ForgetFlow(FlowId flowId);
+
+    /// Clear the per-packet records of the probe, called by
+    /// FlowMonitor::ResetAllStats at the end of every measurement window.
+    /// The default implementation keeps nothing per packet.
+    virtual void ClearPerPacketStats();
 
     /// Serializes the results to an std::ostream in XML format
     /// \param os the output stream
@@ -0,0 +1,145 @@
+// ipv4-aggregate-flow-classifier.cc
+#include "ipv4-aggregate-flow-classifier.h"
+
+#include "ns3/log.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("Ipv4AggregateFlowClassifier");
+
+Ipv4AggregateFlowClassifier::Ipv4AggregateFlowClassifier(uint32_t dimensions)
+    : m_dimensions(dimensions),
+      m_ueNetwork("7.0.0.0"),
+      m_ueMask("255.0.0.0"),
+      m_destinationMask("255.255.255.0")
+{
+    NS_LOG_FUNCTION(this << dimensions);
+    NS_ABORT_MSG_IF(dimensions & ~(UE | DESTINATION_PREFIX | CELL | DSCP),
+                    "Unknown aggregation dimensions " << dimensions);
+}
+
+void
+Ipv4AggregateFlowClassifier::SetUeNetwork(Ipv4Address network, Ipv4Mask mask)
+{
+    m_ueNetwork = network.CombineMask(mask);
+    m_ueMask = mask;
+}
+
+void
+Ipv4AggregateFlowClassifier::SetDestinationMask(Ipv4Mask mask)
+{
+    m_destinationMask = mask;
+}
+
+void
+Ipv4AggregateFlowClassifier::SetCell(Ipv4Address ue, uint16_t cellId)
+{
+    m_cells[ue.Get()] = cellId;
+}
+
+uint32_t
+Ipv4AggregateFlowClassifier::GetDimensions() const
+{
+    return m_dimensions;
+}
+
+bool
+Ipv4AggregateFlowClassifier::Classify(const Ipv4Header& ipHeader,
+                                      Ptr<const Packet> ipPayload,
+                                      uint32_t* out_flowId,
+                                      uint32_t* out_packetId)
+{
+    FiveTuple packet;
+    if (!ReadFiveTuple(ipHeader, ipPayload, &packet))
+    {
+        return false;
+    }
+
+    // In UL the UE is the source, in DL the destination
+    bool downlink = m_ueMask.IsMatch(packet.destinationAddress, m_ueNetwork);
+    Ipv4Address ue = downlink ? packet.destinationAddress : packet.sourceAddress;
+
+    FiveTuple aggregate;
+    aggregate.sourceAddress = Ipv4Address::GetZero();
+    aggregate.destinationAddress = Ipv4Address::GetZero();
+    aggregate.protocol = downlink ? DOWNLINK : UPLINK;
+    aggregate.sourcePort = 0;
+    aggregate.destinationPort = 0;
+    if (m_dimensions & UE)
+    {
+        aggregate.sourceAddress = ue;
+    }
+    if (m_dimensions & DESTINATION_PREFIX)
+    {
+        aggregate.destinationAddress = packet.destinationAddress.CombineMask(m_destinationMask);
+    }
+    if (m_dimensions & CELL)
+    {
+        auto cell = m_cells.find(ue.Get());
+        aggregate.sourcePort = cell != m_cells.end() ? cell->second : 0;
+    }
+    if (m_dimensions & DSCP)
+    {
+        aggregate.destinationPort = ipHeader.GetDscp();
+    }
+
+    ClassifyTuple(aggregate, ipHeader.GetDscp(), out_flowId, out_packetId);
+    return true;
+}
+
+/* static */
+Ipv4FlowClassifier::FiveTuple
+Ipv4AggregateFlowClassifier::Project(const FiveTuple& tuple, uint32_t dimensions)
+{
+    FiveTuple projected = tuple;
+    if (!(dimensions & UE))
+    {
+        projected.sourceAddress = Ipv4Address::GetZero();
+    }
+    if (!(dimensions & DESTINATION_PREFIX))
+    {
+        projected.destinationAddress = Ipv4Address::GetZero();
+    }
+    if (!(dimensions & CELL))
+    {
+        projected.sourcePort = 0;
+    }
+    if (!(dimensions & DSCP))
+    {
+        projected.destinationPort = 0;
+    }
+    return projected;
+}
+
+Ipv4AggregateFlowClassifier::AggregateStatsContainer
+Ipv4AggregateFlowClassifier::RollUp(const FlowMonitor::FlowStatsContainer& stats,
+                                    uint32_t dimensions) const
+{
+    NS_ABORT_MSG_IF(dimensions & ~m_dimensions,
+                    "Cannot roll up on dimensions " << dimensions << " from flows keyed on "
+                                                    << m_dimensions);
+
+    AggregateStatsContainer rollup;
+    for (const auto& [flowId, flowStats] : stats)
+    {
+        // Flows of the other classifiers of the monitor are skipped
+        const FiveTuple* tuple = PeekFlow(flowId);
+        if (!tuple)
+        {
+            continue;
+        }
+        AggregateStats& aggregate = rollup[Project(*tuple, dimensions)];
+        ++aggregate.flows;
+        aggregate.txBytes += flowStats.txBytes;
+        aggregate.rxBytes += flowStats.rxBytes;
+        aggregate.txPackets += flowStats.txPackets;
+        aggregate.rxPackets += flowStats.rxPackets;
+        aggregate.lostPackets += flowStats.lostPackets;
+        aggregate.delaySum += flowStats.delaySum;
+        aggregate.jitterSum += flowStats.jitterSum;
+    }
+    return rollup;
+}
+
+} // namespace ns3
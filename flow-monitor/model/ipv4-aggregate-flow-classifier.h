@@ -0,0 +1,117 @@
+// ipv4-aggregate-flow-classifier.h
+#ifndef IPV4_AGGREGATE_FLOW_CLASSIFIER_H
+#define IPV4_AGGREGATE_FLOW_CLASSIFIER_H
+
+#include "flow-monitor.h"
+#include "ipv4-flow-classifier.h"
+
+#include "ns3/ipv4-address.h"
+
+#include <map>
+#include <unordered_map>
+
+namespace ns3
+{
+
+/// \ingroup flow-monitor
+/// \brief Classifies IPv4 packets into aggregate flows instead of five-tuples
+///
+/// The flow key is built from a set of dimensions: the UE address, the
+/// destination prefix, the DSCP class and the cell serving the UE.  All the
+/// connections sharing the selected dimensions become a single flow, so the
+/// FlowMonitor stats and the per-flow reports scale with the number of
+/// aggregates rather than with the number of connections.
+///
+/// Aggregates are stored as FiveTuples, so FindFlow() and the XML output
+/// keep working.  The protocol field always holds the Direction of the
+/// packets, so UL and DL never share an aggregate.  Each dimension uses its
+/// own field and the unused fields are zero:
+///  - UE: sourceAddress holds the UE address, whichever end of the packet it is
+///  - DESTINATION_PREFIX: destinationAddress holds the masked destination
+///  - CELL: sourcePort holds the cell ID of the UE (0 if unknown)
+///  - DSCP: destinationPort holds the DSCP value
+///
+/// Coarser aggregates (e.g., per cell from per-UE flows) are obtained with
+/// RollUp(), which projects the flows on a subset of the dimensions.
+class Ipv4AggregateFlowClassifier : public Ipv4FlowClassifier
+{
+public:
+    /// Dimensions an aggregate flow can be keyed on
+    enum Dimension : uint32_t
+    {
+        UE = 1 << 0,                 //!< address of the UE end of the packet
+        DESTINATION_PREFIX = 1 << 1, //!< destination address, masked
+        CELL = 1 << 2,               //!< cell serving the UE
+        DSCP = 1 << 3,               //!< DSCP value of the packet
+    };
+
+    /// Direction of the packets of an aggregate, held in its protocol field
+    enum Direction : uint8_t
+    {
+        UPLINK = 1,   //!< the UE is the source of the packets
+        DOWNLINK = 2, //!< the UE is the destination of the packets
+    };
+
+    /// Counters of an aggregate, summed over the flows it rolls up
+    struct AggregateStats
+    {
+        uint32_t flows = 0;       //!< number of flows rolled up
+        uint64_t txBytes = 0;     //!< transmitted bytes
+        uint64_t rxBytes = 0;     //!< received bytes
+        uint32_t txPackets = 0;   //!< transmitted packets
+        uint32_t rxPackets = 0;   //!< received packets
+        uint32_t lostPackets = 0; //!< lost packets
+        Time delaySum;            //!< sum of the end-to-end delays
+        Time jitterSum;           //!< sum of the jitters
+    };
+
+    /// Aggregate key (projected FiveTuple) --> AggregateStats
+    typedef std::map<FiveTuple, AggregateStats> AggregateStatsContainer;
+
+    /// \param dimensions bitwise or of Dimension values
+    explicit Ipv4AggregateFlowClassifier(uint32_t dimensions);
+
+    /// \param network the network the UE addresses belong to
+    /// \param mask the mask of that network
+    void SetUeNetwork(Ipv4Address network, Ipv4Mask mask);
+
+    /// \param mask the mask applied to destinations for DESTINATION_PREFIX
+    void SetDestinationMask(Ipv4Mask mask);
+
+    /// \param ue the address of a UE
+    /// \param cellId the cell serving it
+    void SetCell(Ipv4Address ue, uint16_t cellId);
+
+    /// \returns the dimensions flows are keyed on
+    uint32_t GetDimensions() const;
+
+    bool Classify(const Ipv4Header& ipHeader,
+                  Ptr<const Packet> ipPayload,
+                  uint32_t* out_flowId,
+                  uint32_t* out_packetId) override;
+
+    /// \brief Keep only some dimensions of an aggregate key
+    /// \param tuple an aggregate key
+    /// \param dimensions the dimensions to keep
+    /// \returns the key with the other dimensions zeroed, keeping its direction
+    static FiveTuple Project(const FiveTuple& tuple, uint32_t dimensions);
+
+    /// \brief Sum the stats of this classifier's flows per coarser aggregate
+    /// \param stats the FlowMonitor stats
+    /// \param dimensions the dimensions of the rollup, a subset of GetDimensions()
+    /// \returns the stats per aggregate; zero dimensions give a network-wide total
+    /// per direction
+    AggregateStatsContainer RollUp(const FlowMonitor::FlowStatsContainer& stats,
+                                   uint32_t dimensions) const;
+
+private:
+    uint32_t m_dimensions;      //!< dimensions flows are keyed on
+    Ipv4Address m_ueNetwork;    //!< network of the UE addresses
+    Ipv4Mask m_ueMask;          //!< mask of the UE network
+    Ipv4Mask m_destinationMask; //!< mask of DESTINATION_PREFIX
+    std::unordered_map<uint32_t, uint16_t> m_cells; //!< UE address --> cell ID
+};
+
+} // namespace ns3
+
+#endif /* IPV4_AGGREGATE_FLOW_CLASSIFIER_H */
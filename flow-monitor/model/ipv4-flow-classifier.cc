@@ -91,6 +91,30 @@ operator==(const Ipv4FlowClassifier::FiveTuple& t1, const Ipv4FlowClassifier::Fi
             t1.sourcePort == t2.sourcePort && t1.destinationPort == t2.destinationPort);
 }
 
+/// Finalizer of SplitMix64, spreads every input bit over the whole output
+/// \param x value to mix
+/// \returns the mixed value
+static inline uint64_t
+MixBits(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+std::size_t
+Ipv4FlowClassifier::FiveTupleHash::operator()(const FiveTuple& tuple) const
+{
+    uint64_t addresses = (static_cast<uint64_t>(tuple.sourceAddress.Get()) << 32) |
+                         tuple.destinationAddress.Get();
+    uint64_t ports = (static_cast<uint64_t>(tuple.protocol) << 32) |
+                     (static_cast<uint64_t>(tuple.sourcePort) << 16) | tuple.destinationPort;
+    return static_cast<std::size_t>(MixBits(addresses ^ MixBits(ports)));
+}
+
 Ipv4FlowClassifier::Ipv4FlowClassifier()
 {
 }
@@ -100,6 +124,20 @@ Ipv4FlowClassifier::Classify(const Ipv4Header& ipHeader,
                              Ptr<const Packet> ipPayload,
                              uint32_t* out_flowId,
                              uint32_t* out_packetId)
+{
+    FiveTuple tuple;
+    if (!ReadFiveTuple(ipHeader, ipPayload, &tuple))
+    {
+        return false;
+    }
+    ClassifyTuple(tuple, ipHeader.GetDscp(), out_flowId, out_packetId);
+    return true;
+}
+
+bool
+Ipv4FlowClassifier::ReadFiveTuple(const Ipv4Header& ipHeader,
+                                  Ptr<const Packet> ipPayload,
+                                  FiveTuple* tuple)
 {
     if (ipHeader.GetFragmentOffset() > 0)
     {
@@ -107,12 +145,11 @@ Ipv4FlowClassifier::Classify(const Ipv4Header& ipHeader,
         return false;
     }
 
-    FiveTuple tuple;
-    tuple.sourceAddress = ipHeader.GetSource();
-    tuple.destinationAddress = ipHeader.GetDestination();
-    tuple.protocol = ipHeader.GetProtocol();
+    tuple->sourceAddress = ipHeader.GetSource();
+    tuple->destinationAddress = ipHeader.GetDestination();
+    tuple->protocol = ipHeader.GetProtocol();
 
-    if ((tuple.protocol != UDP_PROT_NUMBER) && (tuple.protocol != TCP_PROT_NUMBER))
+    if ((tuple->protocol != UDP_PROT_NUMBER) && (tuple->protocol != TCP_PROT_NUMBER))
     {
         return false;
     }
@@ -141,55 +178,202 @@ Ipv4FlowClassifier::Classify(const Ipv4Header& ipHeader,
     dstPort <<= 8;
     dstPort |= data[3];
 
-    tuple.sourcePort = srcPort;
-    tuple.destinationPort = dstPort;
+    tuple->sourcePort = srcPort;
+    tuple->destinationPort = dstPort;
+    return true;
+}
 
+void
+Ipv4FlowClassifier::ClassifyTuple(const FiveTuple& tuple,
+                                  Ipv4Header::DscpType dscp,
+                                  uint32_t* out_flowId,
+                                  uint32_t* out_packetId)
+{
     // try to insert the tuple, but check if it already exists
-    auto insert = m_flowMap.insert(std::pair<FiveTuple, FlowId>(tuple, 0));
+    auto insert = m_flowMap.try_emplace(tuple, 0);
+    FlowSlot* slot;
 
     // if the insertion succeeded, we need to assign this tuple a new flow identifier
     if (insert.second)
     {
-        FlowId newFlowId = GetNewFlowId();
-        insert.first->second = newFlowId;
-        m_flowPktIdMap[newFlowId] = 0;
-        m_flowDscpMap[newFlowId];
+        FlowId flowId = GetNewFlowId();
+        uint32_t index;
+        if (m_freeSlots.empty())
+        {
+            index = m_flowSlots.size();
+            m_flowSlots.emplace_back();
+        }
+        else
+        {
+            index = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        insert.first->second = index;
+        m_flowSlotIndex.emplace(flowId, index);
+        slot = &m_flowSlots[index];
+        *slot = FlowSlot{flowId, &insert.first->first, 0, 0, {}};
+
+        // Pair the flow with the opposite direction, if already seen
+        if (tuple.protocol != 0)
+        {
+            auto conversation =
+                m_conversations.try_emplace(Canonicalize(tuple), Conversation{flowId, 0});
+            Conversation& pair = conversation.first->second;
+            if (!conversation.second && pair.reverse == 0)
+            {
+                pair.reverse = flowId;
+                m_flowSlots[m_flowSlotIndex.at(pair.forward)].reverse = flowId;
+                slot->reverse = pair.forward;
+            }
+        }
     }
     else
     {
-        m_flowPktIdMap[insert.first->second]++;
+        slot = &m_flowSlots[insert.first->second];
+        slot->lastPacketId++;
     }
 
     // increment the counter of packets with the same DSCP value
-    Ipv4Header::DscpType dscp = ipHeader.GetDscp();
-    auto dscpInserter = m_flowDscpMap[insert.first->second].insert(
-        std::pair<Ipv4Header::DscpType, uint32_t>(dscp, 1));
+    slot->dscpCounts[dscp]++;
 
-    // if the insertion did not succeed, we need to increment the counter
-    if (!dscpInserter.second)
+    *out_flowId = slot->flowId;
+    *out_packetId = slot->lastPacketId;
+}
+
+const Ipv4FlowClassifier::FlowSlot*
+Ipv4FlowClassifier::FindSlot(FlowId flowId) const
+{
+    auto index = m_flowSlotIndex.find(flowId);
+    return index == m_flowSlotIndex.end() ? nullptr : &m_flowSlots[index->second];
+}
+
+Ipv4FlowClassifier::FiveTuple
+Ipv4FlowClassifier::FindFlow(FlowId flowId) const
+{
+    if (const FiveTuple* tuple = PeekFlow(flowId))
     {
-        m_flowDscpMap[insert.first->second][dscp]++;
+        return *tuple;
     }
+    NS_FATAL_ERROR("Could not find the flow with ID " << flowId);
+    FiveTuple retval = {Ipv4Address::GetZero(), Ipv4Address::GetZero(), 0, 0, 0};
+    return retval;
+}
 
-    *out_flowId = insert.first->second;
-    *out_packetId = m_flowPktIdMap[*out_flowId];
+const Ipv4FlowClassifier::FiveTuple*
+Ipv4FlowClassifier::PeekFlow(FlowId flowId) const
+{
+    const FlowSlot* slot = FindSlot(flowId);
+    return slot ? slot->tuple : nullptr;
+}
 
+bool
+Ipv4FlowClassifier::LookupFlow(const Ipv4Header& ipHeader,
+                               Ptr<const Packet> ipPayload,
+                               FlowId* out_flowId) const
+{
+    FiveTuple tuple;
+    if (!ReadFiveTuple(ipHeader, ipPayload, &tuple))
+    {
+        return false;
+    }
+    auto flow = m_flowMap.find(tuple);
+    if (flow == m_flowMap.end())
+    {
+        return false;
+    }
+    *out_flowId = m_flowSlots[flow->second].flowId;
     return true;
 }
 
+FlowId
+Ipv4FlowClassifier::GetReverseFlow(FlowId flowId) const
+{
+    const FlowSlot* slot = FindSlot(flowId);
+    return slot ? slot->reverse : 0;
+}
+
+/* static */
 Ipv4FlowClassifier::FiveTuple
-Ipv4FlowClassifier::FindFlow(FlowId flowId) const
+Ipv4FlowClassifier::Canonicalize(const FiveTuple& tuple)
 {
-    for (auto iter = m_flowMap.begin(); iter != m_flowMap.end(); iter++)
+    if (tuple.sourceAddress < tuple.destinationAddress ||
+        (tuple.sourceAddress == tuple.destinationAddress &&
+         tuple.sourcePort <= tuple.destinationPort))
     {
-        if (iter->second == flowId)
+        return tuple;
+    }
+    return FiveTuple{tuple.destinationAddress,
+                     tuple.sourceAddress,
+                     tuple.protocol,
+                     tuple.destinationPort,
+                     tuple.sourcePort};
+}
+
+std::vector<std::pair<FlowId, Ipv4FlowClassifier::FiveTuple>>
+Ipv4FlowClassifier::GetAllFlows() const
+{
+    std::vector<std::pair<FlowId, FiveTuple>> flows;
+    flows.reserve(m_flowMap.size());
+    for (const FlowSlot& slot : m_flowSlots)
+    {
+        if (slot.flowId != 0)
         {
-            return iter->first;
+            flows.emplace_back(slot.flowId, *slot.tuple);
+        }
+    }
+    // Slots are reused, so they are not in FlowId order
+    std::sort(flows.begin(), flows.end(), [](const auto& left, const auto& right) {
+        return left.first < right.first;
+    });
+    return flows;
+}
+
+bool
+Ipv4FlowClassifier::WriteFlowKey(std::ostream& os, FlowId flowId) const
+{
+    const FiveTuple* tuple = PeekFlow(flowId);
+    if (!tuple)
+    {
+        return false;
+    }
+    os << tuple->sourceAddress << "," << tuple->destinationAddress << ","
+       << int(tuple->protocol) << "," << tuple->sourcePort << "," << tuple->destinationPort;
+    return true;
+}
+
+void
+Ipv4FlowClassifier::ForgetFlow(FlowId flowId)
+{
+    auto index = m_flowSlotIndex.find(flowId);
+    if (index == m_flowSlotIndex.end())
+    {
+        return;
+    }
+    // The slot is reused by the next new flow, FlowIds are never reused
+    FlowSlot& slot = m_flowSlots[index->second];
+    FiveTuple key = *slot.tuple;
+    FlowId reverse = slot.reverse;
+    slot.flowId = 0;
+    slot.tuple = nullptr;
+    m_freeSlots.push_back(index->second);
+    m_flowSlotIndex.erase(index);
+    m_flowMap.erase(key);
+
+    // The remaining direction, if any, keeps the conversation
+    auto conversation = m_conversations.find(Canonicalize(key));
+    if (conversation != m_conversations.end())
+    {
+        Conversation& pair = conversation->second;
+        if (reverse == 0)
+        {
+            m_conversations.erase(conversation);
+        }
+        else
+        {
+            pair = Conversation{reverse, 0};
+            m_flowSlots[m_flowSlotIndex.at(reverse)].reverse = 0;
         }
     }
-    NS_FATAL_ERROR("Could not find the flow with ID " << flowId);
-    FiveTuple retval = {Ipv4Address::GetZero(), Ipv4Address::GetZero(), 0, 0, 0};
-    return retval;
 }
 
 bool
@@ -202,15 +386,25 @@ Ipv4FlowClassifier::SortByCount::operator()(std::pair<Ipv4Header::DscpType, uint
 std::vector<std::pair<Ipv4Header::DscpType, uint32_t>>
 Ipv4FlowClassifier::GetDscpCounts(FlowId flowId) const
 {
-    auto flow = m_flowDscpMap.find(flowId);
+    std::vector<std::pair<Ipv4Header::DscpType, uint32_t>> v;
+    if (const FlowSlot* slot = FindSlot(flowId))
+    {
+        const auto& counts = slot->dscpCounts;
+        for (uint32_t dscp = 0; dscp < DSCP_VALUES; dscp++)
+        {
+            if (counts[dscp] > 0)
+            {
+                v.emplace_back(static_cast<Ipv4Header::DscpType>(dscp), counts[dscp]);
+            }
+        }
+    }
 
-    if (flow == m_flowDscpMap.end())
+    // every classified flow has counted at least one packet
+    if (v.empty())
     {
         NS_FATAL_ERROR("Could not find the flow with ID " << flowId);
     }
 
-    std::vector<std::pair<Ipv4Header::DscpType, uint32_t>> v(flow->second.begin(),
-                                                             flow->second.end());
     std::sort(v.begin(), v.end(), SortByCount());
     return v;
 }
@@ -222,26 +416,26 @@ Ipv4FlowClassifier::SerializeToXmlStream(std::ostream& os, uint16_t indent) cons
     os << "<Ipv4FlowClassifier>\n";
 
     indent += 2;
-    for (auto iter = m_flowMap.begin(); iter != m_flowMap.end(); iter++)
+    for (const auto& [flowId, tuple] : GetAllFlows())
     {
+        const FlowSlot* slot = FindSlot(flowId);
         Indent(os, indent);
-        os << "<Flow flowId=\"" << iter->second << "\""
-           << " sourceAddress=\"" << iter->first.sourceAddress << "\""
-           << " destinationAddress=\"" << iter->first.destinationAddress << "\""
-           << " protocol=\"" << int(iter->first.protocol) << "\""
-           << " sourcePort=\"" << iter->first.sourcePort << "\""
-           << " destinationPort=\"" << iter->first.destinationPort << "\">\n";
+        os << "<Flow flowId=\"" << flowId << "\""
+           << " sourceAddress=\"" << tuple.sourceAddress << "\""
+           << " destinationAddress=\"" << tuple.destinationAddress << "\""
+           << " protocol=\"" << int(tuple.protocol) << "\""
+           << " sourcePort=\"" << tuple.sourcePort << "\""
+           << " destinationPort=\"" << tuple.destinationPort << "\">\n";
 
         indent += 2;
-        auto flow = m_flowDscpMap.find(iter->second);
-
-        if (flow != m_flowDscpMap.end())
+        const auto& counts = slot->dscpCounts;
+        for (uint32_t dscp = 0; dscp < DSCP_VALUES; dscp++)
         {
-            for (auto i = flow->second.begin(); i != flow->second.end(); i++)
+            if (counts[dscp] > 0)
             {
                 Indent(os, indent);
-                os << "<Dscp value=\"0x" << std::hex << static_cast<uint32_t>(i->first) << "\""
-                   << " packets=\"" << std::dec << i->second << "\" />\n";
+                os << "<Dscp value=\"0x" << std::hex << dscp << "\""
+                   << " packets=\"" << std::dec << counts[dscp] << "\" />\n";
             }
         }
 
@@ -24,8 +24,10 @@
 
 #include "ns3/ipv4-header.h"
 
-#include <map>
+#include <array>
 #include <stdint.h>
+#include <unordered_map>
+#include <vector>
 
 namespace ns3
 {
@@ -49,6 +51,17 @@ class Ipv4FlowClassifier : public FlowClassifier
         uint16_t destinationPort;       //!< Destination port
     };
 
+    /// Hash function of a FiveTuple, mixing all of its fields
+    struct FiveTupleHash
+    {
+        /// \param tuple the FiveTuple to hash
+        /// \returns the hash value
+        std::size_t operator()(const FiveTuple& tuple) const;
+    };
+
+    /// Number of DSCP values (6-bit field)
+    static constexpr uint32_t DSCP_VALUES = 64;
+
     Ipv4FlowClassifier();
 
     /// \brief try to classify the packet into flow-id and packet-id
@@ -61,16 +74,41 @@ class Ipv4FlowClassifier : public FlowClassifier
     /// \param ipPayload packet's IP payload
     /// \param out_flowId packet's FlowId
     /// \param out_packetId packet's identifier
-    bool Classify(const Ipv4Header& ipHeader,
-                  Ptr<const Packet> ipPayload,
-                  uint32_t* out_flowId,
-                  uint32_t* out_packetId);
+    virtual bool Classify(const Ipv4Header& ipHeader,
+                          Ptr<const Packet> ipPayload,
+                          uint32_t* out_flowId,
+                          uint32_t* out_packetId);
 
-    /// Searches for the FiveTuple corresponding to the given flowId
+    /// Searches for the FiveTuple corresponding to the given flowId, in constant time
     /// \param flowId the FlowId to search for
     /// \returns the FiveTuple corresponding to flowId
     FiveTuple FindFlow(FlowId flowId) const;
 
+    /// Searches for the FiveTuple corresponding to the given flowId
+    /// \param flowId the FlowId to search for
+    /// \returns the FiveTuple of the flow, or nullptr if it was not
+    /// classified by this classifier
+    const FiveTuple* PeekFlow(FlowId flowId) const;
+
+    /// \brief find the flow of a packet without classifying it, in constant time
+    /// \param ipHeader packet's IP header
+    /// \param ipPayload packet's IP payload
+    /// \param out_flowId packet's FlowId
+    /// \return true if the packet belongs to a flow classified so far
+    bool LookupFlow(const Ipv4Header& ipHeader,
+                    Ptr<const Packet> ipPayload,
+                    FlowId* out_flowId) const;
+
+    /// \brief get the flow of the opposite direction of the same conversation,
+    /// i.e., with the addresses and ports swapped, in constant time
+    /// \param flowId the FlowId of one direction
+    /// \returns the FlowId of the other direction, or 0 if it was not seen
+    FlowId GetReverseFlow(FlowId flowId) const;
+
+    /// \brief get the FiveTuple of every flow classified so far
+    /// \returns (FlowId, FiveTuple) pairs, sorted by FlowId
+    std::vector<std::pair<FlowId, FiveTuple>> GetAllFlows() const;
+
     /// Comparator used to sort the vector of DSCP values
     class SortByCount
     {
@@ -92,13 +130,68 @@ class Ipv4FlowClassifier : public FlowClassifier
 
     void SerializeToXmlStream(std::ostream& os, uint16_t indent) const override;
 
+    bool WriteFlowKey(std::ostream& os, FlowId flowId) const override;
+
+    void ForgetFlow(FlowId flowId) override;
+
+  protected:
+    /// \brief read the five-tuple of a packet
+    /// \param ipHeader packet's IP header
+    /// \param ipPayload packet's IP payload
+    /// \param tuple filled with the packet's five-tuple
+    /// \return true if the packet is a TCP or UDP packet carrying its ports
+    static bool ReadFiveTuple(const Ipv4Header& ipHeader,
+                              Ptr<const Packet> ipPayload,
+                              FiveTuple* tuple);
+
+    /// \brief assign the flow-id and packet-id of a packet from its flow's tuple
+    /// \param tuple the tuple identifying the flow
+    /// \param dscp packet's DSCP value
+    /// \param out_flowId packet's FlowId
+    /// \param out_packetId packet's identifier
+    void ClassifyTuple(const FiveTuple& tuple,
+                       Ipv4Header::DscpType dscp,
+                       uint32_t* out_flowId,
+                       uint32_t* out_packetId);
+
   private:
-    /// Map to Flows Identifiers to FlowIds
-    std::map<FiveTuple, FlowId> m_flowMap;
-    /// Map to FlowIds to FlowPacketId
-    std::map<FlowId, FlowPacketId> m_flowPktIdMap;
-    /// Map FlowIds to (DSCP value, packet count) pairs
-    std::map<FlowId, std::map<Ipv4Header::DscpType, uint32_t>> m_flowDscpMap;
+    /// Both directions of a conversation
+    struct Conversation
+    {
+        FlowId forward; //!< the direction seen first
+        FlowId reverse; //!< the other direction, 0 until seen
+    };
+
+    /// \param tuple a five-tuple
+    /// \returns the tuple with the lower (address, port) endpoint as source,
+    /// the same for both directions of a conversation
+    static FiveTuple Canonicalize(const FiveTuple& tuple);
+
+    /// State of a flow, in a slot of m_flowSlots reused once the flow is forgotten
+    struct FlowSlot
+    {
+        FlowId flowId;                                //!< the flow, 0 if the slot is free
+        const FiveTuple* tuple;                       //!< key of the flow in m_flowMap
+        FlowPacketId lastPacketId;                    //!< FlowPacketId of the last packet
+        FlowId reverse;                               //!< reverse direction, 0 if none
+        std::array<uint32_t, DSCP_VALUES> dscpCounts; //!< packet count per DSCP value
+    };
+
+    /// \param flowId a FlowId
+    /// \returns the slot of the flow, or nullptr if it is not a flow of this classifier
+    const FlowSlot* FindSlot(FlowId flowId) const;
+
+    /// Five-tuple --> index of its flow's slot.  Elements of an unordered_map
+    /// keep their address on rehash, so the slots point to their key.
+    std::unordered_map<FiveTuple, uint32_t, FiveTupleHash> m_flowMap;
+    /// FlowId --> index of its flow's slot, for the queries by FlowId
+    std::unordered_map<FlowId, uint32_t> m_flowSlotIndex;
+    /// State of the flows, both live and free slots
+    std::vector<FlowSlot> m_flowSlots;
+    /// Indexes of the free slots of m_flowSlots
+    std::vector<uint32_t> m_freeSlots;
+    /// Canonical five-tuple --> Conversation, for TCP and UDP flows
+    std::unordered_map<FiveTuple, Conversation, FiveTupleHash> m_conversations;
 };
 
 /**
@@ -251,6 +251,7 @@ Ipv4FlowProbe::Ipv4FlowProbe(Ptr<FlowMonitor> monitor,
                              Ptr<Ipv4FlowClassifier> classifier,
                              Ptr<Node> node)
     : FlowProbe(monitor),
+      m_reportInterface(Ipv4::IF_ANY),
       m_classifier(classifier)
 {
     NS_LOG_FUNCTION(this << node->GetId());
@@ -313,6 +314,21 @@ Ipv4FlowProbe::GetTypeId()
     return tid;
 }
 
+bool
+Ipv4FlowProbe::PeekFlowIdentifiers(Ptr<const Packet> ipPayload,
+                                   FlowId* flowId,
+                                   FlowPacketId* packetId)
+{
+    Ipv4FlowProbeTag fTag;
+    if (!ipPayload->FindFirstMatchingByteTag(fTag))
+    {
+        return false;
+    }
+    *flowId = fTag.GetFlowId();
+    *packetId = fTag.GetPacketId();
+    return true;
+}
+
 void
 Ipv4FlowProbe::DoDispose()
 {
@@ -347,6 +363,7 @@ Ipv4FlowProbe::SendOutgoingLogger(const Ipv4Header& ipHeader,
         uint32_t size = (ipPayload->GetSize() + ipHeader.GetSerializedSize());
         NS_LOG_DEBUG("ReportFirstTx (" << this << ", " << flowId << ", " << packetId << ", " << size
                                        << "); " << ipHeader << *ipPayload);
+        m_reportInterface = interface;
         m_flowMonitor->ReportFirstTx(this, flowId, packetId, size);
 
         // tag the packet with the flow id and packet id, so that the packet can be identified even
@@ -387,6 +404,7 @@ Ipv4FlowProbe::ForwardLogger(const Ipv4Header& ipHeader,
         uint32_t size = (ipPayload->GetSize() + ipHeader.GetSerializedSize());
         NS_LOG_DEBUG("ReportForwarding (" << this << ", " << flowId << ", " << packetId << ", "
                                           << size << ");");
+        m_reportInterface = interface;
         m_flowMonitor->ReportForwarding(this, flowId, packetId, size);
     }
 }
@@ -413,6 +431,7 @@ Ipv4FlowProbe::ForwardUpLogger(const Ipv4Header& ipHeader,
         uint32_t size = (ipPayload->GetSize() + ipHeader.GetSerializedSize());
         NS_LOG_DEBUG("ReportLastRx (" << this << ", " << flowId << ", " << packetId << ", " << size
                                       << "); " << ipHeader << *ipPayload);
+        m_reportInterface = interface;
         m_flowMonitor->ReportLastRx(this, flowId, packetId, size);
     }
 }
@@ -489,6 +508,7 @@ Ipv4FlowProbe::DropLogger(const Ipv4Header& ipHeader,
             NS_FATAL_ERROR("Unexpected drop reason code " << reason);
         }
 
+        m_reportInterface = ifIndex;
         m_flowMonitor->ReportDrop(this, flowId, packetId, size, myReason);
     }
 }
@@ -511,6 +531,7 @@ Ipv4FlowProbe::QueueDropLogger(Ptr<const Packet> ipPayload)
     NS_LOG_DEBUG("Drop (" << this << ", " << flowId << ", " << packetId << ", " << size << ", "
                           << DROP_QUEUE << "); ");
 
+    m_reportInterface = Ipv4::IF_ANY;
     m_flowMonitor->ReportDrop(this, flowId, packetId, size, DROP_QUEUE);
 }
 
@@ -532,6 +553,7 @@ Ipv4FlowProbe::QueueDiscDropLogger(Ptr<const QueueDiscItem> item)
     NS_LOG_DEBUG("Drop (" << this << ", " << flowId << ", " << packetId << ", " << size << ", "
                           << DROP_QUEUE_DISC << "); ");
 
+    m_reportInterface = Ipv4::IF_ANY;
     m_flowMonitor->ReportDrop(this, flowId, packetId, size, DROP_QUEUE_DISC);
 }
 
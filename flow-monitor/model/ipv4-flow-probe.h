@@ -81,9 +81,26 @@ class Ipv4FlowProbe : public FlowProbe
         DROP_INVALID_REASON, /**< Fallback reason (no known reason) */
     };
 
+    /// \brief Read the identifiers given to a packet by the first Ipv4FlowProbe it crossed
+    ///
+    /// Lets probes hooked below or beside the IPv4 layer (e.g., NrFlowProbe)
+    /// attribute their measurements to a flow packet.
+    /// \param ipPayload IP payload, possibly encapsulated
+    /// \param flowId filled with the packet's FlowId
+    /// \param packetId filled with the packet's identifier
+    /// \returns true if the packet carries the probe tag
+    static bool PeekFlowIdentifiers(Ptr<const Packet> ipPayload,
+                                    FlowId* flowId,
+                                    FlowPacketId* packetId);
+
   protected:
     void DoDispose() override;
 
+    /// Interface index of the packet event currently being reported to
+    /// the FlowMonitor, or Ipv4::IF_ANY when the event is not bound to an
+    /// interface (e.g., queue drops)
+    uint32_t m_reportInterface;
+
   private:
     /// Log a packet being sent
     /// \param ipHeader IP header
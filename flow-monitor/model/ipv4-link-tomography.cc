@@ -0,0 +1,313 @@
+// ipv4-link-tomography.cc
+#include "ipv4-link-tomography.h"
+
+#include "ns3/channel.h"
+#include "ns3/ipv4-route.h"
+#include "ns3/ipv4-routing-protocol.h"
+#include "ns3/ipv4.h"
+#include "ns3/log.h"
+#include "ns3/net-device.h"
+#include "ns3/node-list.h"
+#include "ns3/packet.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("Ipv4LinkTomography");
+
+/// Longest path traced, to stop on routing loops
+static const uint32_t MAX_PATH_HOPS = 64;
+
+Ptr<Node>
+Ipv4LinkTomography::FindNode(Ipv4Address address)
+{
+    for (auto it = NodeList::Begin(); it != NodeList::End(); ++it)
+    {
+        Ptr<Ipv4> ipv4 = (*it)->GetObject<Ipv4>();
+        if (ipv4 && ipv4->GetInterfaceForAddress(address) >= 0)
+        {
+            return *it;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<uint32_t>
+Ipv4LinkTomography::TracePath(Ptr<Node> source, Ipv4Address destination)
+{
+    NS_LOG_FUNCTION(source->GetId() << destination);
+    Ipv4Header header;
+    header.SetDestination(destination);
+
+    std::vector<uint32_t> nodes{source->GetId()};
+    Ptr<Node> node = source;
+    for (uint32_t hop = 0; hop < MAX_PATH_HOPS; hop++)
+    {
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        if (!ipv4 || !ipv4->GetRoutingProtocol())
+        {
+            return {};
+        }
+        if (ipv4->GetInterfaceForAddress(destination) >= 0)
+        {
+            return nodes;
+        }
+        Socket::SocketErrno error;
+        Ptr<Ipv4Route> route =
+            ipv4->GetRoutingProtocol()->RouteOutput(Create<Packet>(), header, nullptr, error);
+        if (!route || !route->GetOutputDevice() || !route->GetOutputDevice()->GetChannel())
+        {
+            NS_LOG_DEBUG("No route to " << destination << " at node " << node->GetId());
+            return {};
+        }
+        // A zero gateway means the destination is on the link
+        Ipv4Address nextHop = route->GetGateway();
+        if (nextHop == Ipv4Address::GetZero())
+        {
+            nextHop = destination;
+        }
+
+        Ptr<NetDevice> device = route->GetOutputDevice();
+        Ptr<Channel> channel = device->GetChannel();
+        Ptr<Node> next;
+        for (std::size_t i = 0; i < channel->GetNDevices() && !next; i++)
+        {
+            Ptr<NetDevice> peer = channel->GetDevice(i);
+            Ptr<Ipv4> peerIpv4 = peer == device ? nullptr : peer->GetNode()->GetObject<Ipv4>();
+            int32_t interface = peerIpv4 ? peerIpv4->GetInterfaceForDevice(peer) : -1;
+            for (uint32_t a = 0; interface >= 0 && a < peerIpv4->GetNAddresses(interface); a++)
+            {
+                if (peerIpv4->GetAddress(interface, a).GetLocal() == nextHop)
+                {
+                    next = peer->GetNode();
+                }
+            }
+        }
+        if (!next)
+        {
+            NS_LOG_DEBUG("Next hop " << nextHop << " of node " << node->GetId() << " not found");
+            return {};
+        }
+        nodes.push_back(next->GetId());
+        node = next;
+    }
+    NS_LOG_DEBUG("Routing loop towards " << destination);
+    return {};
+}
+
+void
+Ipv4LinkTomography::AddPath(const std::vector<uint32_t>& nodes, Time meanDelay, double weight)
+{
+    Path path{{}, meanDelay.GetSeconds(), weight};
+    for (std::size_t i = 1; i < nodes.size(); i++)
+    {
+        Link link = std::minmax(nodes[i - 1], nodes[i]);
+        auto insert = m_linkIndex.emplace(link, m_links.size());
+        if (insert.second)
+        {
+            m_links.push_back(link);
+        }
+        path.links.push_back(insert.first->second);
+    }
+    if (!path.links.empty())
+    {
+        m_paths.push_back(path);
+    }
+}
+
+uint32_t
+Ipv4LinkTomography::AddFlows(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier)
+{
+    NS_LOG_FUNCTION(this);
+    uint32_t traced = 0;
+    for (const auto& [flowId, stats] : monitor->GetFlowStats())
+    {
+        const Ipv4FlowClassifier::FiveTuple* tuple = classifier->PeekFlow(flowId);
+        if (!tuple || stats.rxPackets == 0)
+        {
+            continue;
+        }
+        Ptr<Node> source = FindNode(tuple->sourceAddress);
+        if (!source)
+        {
+            continue;
+        }
+        auto key = std::make_pair(source->GetId(), tuple->destinationAddress.Get());
+        auto route = m_routes.find(key);
+        if (route == m_routes.end())
+        {
+            route = m_routes.emplace(key, TracePath(source, tuple->destinationAddress)).first;
+        }
+        if (route->second.size() < 2)
+        {
+            continue;
+        }
+        AddPath(route->second, stats.delaySum / stats.rxPackets, stats.rxPackets);
+        ++traced;
+    }
+    return traced;
+}
+
+std::vector<bool>
+Ipv4LinkTomography::FindIdentifiableLinks() const
+{
+    // Reduced row echelon form of the routing matrix: a link is identifiable
+    // if its unit vector is in the row space, i.e. its column has a pivot
+    // whose row has no other non-zero entry
+    const double epsilon = 1e-9;
+    std::size_t nLinks = m_links.size();
+    std::vector<std::vector<double>> rows;
+    rows.reserve(m_paths.size());
+    for (const Path& path : m_paths)
+    {
+        std::vector<double> row(nLinks, 0.0);
+        for (uint32_t link : path.links)
+        {
+            row[link] += 1.0;
+        }
+        rows.push_back(row);
+    }
+
+    std::vector<int64_t> pivotRow(nLinks, -1);
+    std::size_t rank = 0;
+    for (std::size_t column = 0; column < nLinks && rank < rows.size(); column++)
+    {
+        std::size_t best = rank;
+        for (std::size_t r = rank + 1; r < rows.size(); r++)
+        {
+            if (std::abs(rows[r][column]) > std::abs(rows[best][column]))
+            {
+                best = r;
+            }
+        }
+        if (std::abs(rows[best][column]) < epsilon)
+        {
+            continue;
+        }
+        std::swap(rows[rank], rows[best]);
+        double pivot = rows[rank][column];
+        for (double& value : rows[rank])
+        {
+            value /= pivot;
+        }
+        for (std::size_t r = 0; r < rows.size(); r++)
+        {
+            double factor = rows[r][column];
+            if (r == rank || std::abs(factor) < epsilon)
+            {
+                continue;
+            }
+            for (std::size_t c = column; c < nLinks; c++)
+            {
+                rows[r][c] -= factor * rows[rank][c];
+            }
+        }
+        pivotRow[column] = rank++;
+    }
+
+    std::vector<bool> identifiable(nLinks, false);
+    for (std::size_t column = 0; column < nLinks; column++)
+    {
+        if (pivotRow[column] < 0)
+        {
+            continue;
+        }
+        const std::vector<double>& row = rows[pivotRow[column]];
+        identifiable[column] = true;
+        for (std::size_t c = 0; c < nLinks; c++)
+        {
+            if (c != column && std::abs(row[c]) >= epsilon)
+            {
+                identifiable[column] = false;
+                break;
+            }
+        }
+    }
+    return identifiable;
+}
+
+Ipv4LinkTomography::LinkEstimates
+Ipv4LinkTomography::Solve(uint32_t maxSweeps, Time tolerance) const
+{
+    NS_LOG_FUNCTION(this << maxSweeps << tolerance);
+    std::size_t nLinks = m_links.size();
+    std::vector<std::vector<uint32_t>> pathsOfLink(nLinks);
+    std::vector<double> linkWeight(nLinks, 0.0);
+    std::vector<double> residual(m_paths.size());
+    for (uint32_t p = 0; p < m_paths.size(); p++)
+    {
+        residual[p] = m_paths[p].delay;
+        for (uint32_t link : m_paths[p].links)
+        {
+            pathsOfLink[link].push_back(p);
+            linkWeight[link] += m_paths[p].weight;
+        }
+    }
+
+    // Coordinate descent on the weighted least squares, projected on the
+    // non-negative delays: each step is the exact minimum along one link
+    std::vector<double> delay(nLinks, 0.0);
+    double stop = tolerance.GetSeconds();
+    for (uint32_t sweep = 0; sweep < maxSweeps; sweep++)
+    {
+        double maxChange = 0;
+        for (std::size_t link = 0; link < nLinks; link++)
+        {
+            if (linkWeight[link] <= 0)
+            {
+                continue;
+            }
+            double sum = 0;
+            for (uint32_t p : pathsOfLink[link])
+            {
+                sum += m_paths[p].weight * (residual[p] + delay[link]);
+            }
+            double change = std::max(0.0, sum / linkWeight[link]) - delay[link];
+            if (change == 0)
+            {
+                continue;
+            }
+            for (uint32_t p : pathsOfLink[link])
+            {
+                residual[p] -= change;
+            }
+            delay[link] += change;
+            maxChange = std::max(maxChange, std::abs(change));
+        }
+        if (maxChange <= stop)
+        {
+            NS_LOG_DEBUG("Converged after " << sweep + 1 << " sweeps");
+            break;
+        }
+    }
+
+    std::vector<bool> identifiable = FindIdentifiableLinks();
+    LinkEstimates estimates;
+    for (std::size_t link = 0; link < nLinks; link++)
+    {
+        LinkEstimate& estimate = estimates[m_links[link]];
+        estimate.delay = Seconds(delay[link]);
+        estimate.paths = pathsOfLink[link].size();
+        estimate.identifiable = identifiable[link];
+    }
+    return estimates;
+}
+
+uint32_t
+Ipv4LinkTomography::GetNPaths() const
+{
+    return m_paths.size();
+}
+
+void
+Ipv4LinkTomography::Clear()
+{
+    m_linkIndex.clear();
+    m_links.clear();
+    m_paths.clear();
+}
+
+} // namespace ns3
@@ -0,0 +1,105 @@
+// ipv4-link-tomography.h
+#ifndef IPV4_LINK_TOMOGRAPHY_H
+#define IPV4_LINK_TOMOGRAPHY_H
+
+#include "flow-monitor.h"
+#include "ipv4-flow-classifier.h"
+
+#include "ns3/ipv4-address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+/// \ingroup flow-monitor
+/// \brief Infers the delay of every link from end-to-end delays (network tomography)
+///
+/// Only the edge nodes need flow probes: each flow gives the mean delay of
+/// its path, and the paths are traced hop by hop through the routing tables
+/// of the nodes' Ipv4.  The link delays are the non-negative least-squares
+/// solution of the routing matrix system, each path weighted by its number
+/// of received packets.
+///
+/// Links are undirected node pairs, lower node ID first, as in the
+/// node-to-node reports of the big-brother probes.  A link is identifiable
+/// when its delay is determined by the measured paths; the delays of the
+/// others are only one of the solutions fitting the paths, e.g. two links
+/// always crossed together only have their sum determined.
+class Ipv4LinkTomography
+{
+public:
+    /// Link between two nodes, lower node ID first
+    typedef std::pair<uint32_t, uint32_t> Link;
+
+    /// Inferred delay of a link
+    struct LinkEstimate
+    {
+        Time delay;                //!< inferred one-way delay
+        uint32_t paths = 0;        //!< number of measured paths crossing the link
+        bool identifiable = false; //!< true if the paths determine the delay
+    };
+
+    /// Link --> LinkEstimate
+    typedef std::map<Link, LinkEstimate> LinkEstimates;
+
+    /// \brief Follow the routing tables from a node to a destination
+    /// \param source the node sending the packets
+    /// \param destination the destination address
+    /// \returns the IDs of the nodes crossed, source and destination
+    /// included, or an empty vector if a hop has no route
+    static std::vector<uint32_t> TracePath(Ptr<Node> source, Ipv4Address destination);
+
+    /// \brief Add a measured path
+    /// \param nodes the IDs of the nodes crossed, in order
+    /// \param meanDelay the mean end-to-end delay of the path
+    /// \param weight the weight of the path in the fit, e.g. its number of packets
+    void AddPath(const std::vector<uint32_t>& nodes, Time meanDelay, double weight);
+
+    /// \brief Add a path for every flow of the monitor that received packets
+    /// \param monitor the FlowMonitor, with probes on the flows' edge nodes at least
+    /// \param classifier the classifier of the monitor
+    /// \returns the number of flows whose path could be traced
+    uint32_t AddFlows(Ptr<FlowMonitor> monitor, Ptr<Ipv4FlowClassifier> classifier);
+
+    /// \brief Solve the link delays
+    /// \param maxSweeps maximum number of coordinate-descent sweeps over the links
+    /// \param tolerance stop when no delay changes by more than this
+    /// \returns the estimates of every link crossed by a path
+    LinkEstimates Solve(uint32_t maxSweeps = 10000, Time tolerance = PicoSeconds(1)) const;
+
+    /// \returns the number of paths added
+    uint32_t GetNPaths() const;
+
+    /// Forget the paths, keeping the traced routes
+    void Clear();
+
+private:
+    /// \param address an address
+    /// \returns the node owning the address, or nullptr
+    static Ptr<Node> FindNode(Ipv4Address address);
+
+    /// \returns for every link, whether the paths determine its delay
+    std::vector<bool> FindIdentifiableLinks() const;
+
+    /// A measured path
+    struct Path
+    {
+        std::vector<uint32_t> links; //!< indexes of the links crossed
+        double delay;                //!< mean delay, in seconds
+        double weight;               //!< weight in the fit
+    };
+
+    std::map<Link, uint32_t> m_linkIndex; //!< Link --> index in m_links
+    std::vector<Link> m_links;            //!< links crossed by the paths
+    std::vector<Path> m_paths;            //!< measured paths
+    /// (source node, destination address) --> nodes crossed
+    std::map<std::pair<uint32_t, uint32_t>, std::vector<uint32_t>> m_routes;
+};
+
+} // namespace ns3
+
+#endif /* IPV4_LINK_TOMOGRAPHY_H */
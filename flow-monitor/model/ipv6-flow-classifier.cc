@@ -153,6 +153,7 @@ Ipv6FlowClassifier::Classify(const Ipv6Header& ipHeader,
     {
         FlowId newFlowId = GetNewFlowId();
         insert.first->second = newFlowId;
+        m_flowTuples[newFlowId] = &insert.first->first;
         m_flowPktIdMap[newFlowId] = 0;
         m_flowDscpMap[newFlowId];
     }
@@ -181,18 +182,50 @@ Ipv6FlowClassifier::Classify(const Ipv6Header& ipHeader,
 Ipv6FlowClassifier::FiveTuple
 Ipv6FlowClassifier::FindFlow(FlowId flowId) const
 {
-    for (auto iter = m_flowMap.begin(); iter != m_flowMap.end(); iter++)
+    if (const FiveTuple* tuple = PeekFlow(flowId))
     {
-        if (iter->second == flowId)
-        {
-            return iter->first;
-        }
+        return *tuple;
     }
     NS_FATAL_ERROR("Could not find the flow with ID " << flowId);
     FiveTuple retval = {Ipv6Address::GetZero(), Ipv6Address::GetZero(), 0, 0, 0};
     return retval;
 }
 
+const Ipv6FlowClassifier::FiveTuple*
+Ipv6FlowClassifier::PeekFlow(FlowId flowId) const
+{
+    auto tuple = m_flowTuples.find(flowId);
+    return tuple == m_flowTuples.end() ? nullptr : tuple->second;
+}
+
+bool
+Ipv6FlowClassifier::WriteFlowKey(std::ostream& os, FlowId flowId) const
+{
+    auto tuple = m_flowTuples.find(flowId);
+    if (tuple == m_flowTuples.end())
+    {
+        return false;
+    }
+    os << tuple->second->sourceAddress << "," << tuple->second->destinationAddress << ","
+       << int(tuple->second->protocol) << "," << tuple->second->sourcePort << ","
+       << tuple->second->destinationPort;
+    return true;
+}
+
+void
+Ipv6FlowClassifier::ForgetFlow(FlowId flowId)
+{
+    auto tuple = m_flowTuples.find(flowId);
+    if (tuple == m_flowTuples.end())
+    {
+        return;
+    }
+    m_flowMap.erase(*tuple->second);
+    m_flowTuples.erase(tuple);
+    m_flowPktIdMap.erase(flowId);
+    m_flowDscpMap.erase(flowId);
+}
+
 bool
 Ipv6FlowClassifier::SortByCount::operator()(std::pair<Ipv6Header::DscpType, uint32_t> left,
                                             std::pair<Ipv6Header::DscpType, uint32_t> right)
@@ -72,6 +72,12 @@ class Ipv6FlowClassifier : public FlowClassifier
     /// \returns the FiveTuple corresponding to flowId
     FiveTuple FindFlow(FlowId flowId) const;
 
+    /// Searches for the FiveTuple corresponding to the given flowId
+    /// \param flowId the FlowId to search for
+    /// \returns the FiveTuple of the flow, or nullptr if it was not
+    /// classified by this classifier
+    const FiveTuple* PeekFlow(FlowId flowId) const;
+
     /// Comparator used to sort the vector of DSCP values
     class SortByCount
     {
@@ -93,9 +99,15 @@ class Ipv6FlowClassifier : public FlowClassifier
 
     void SerializeToXmlStream(std::ostream& os, uint16_t indent) const override;
 
+    bool WriteFlowKey(std::ostream& os, FlowId flowId) const override;
+
+    void ForgetFlow(FlowId flowId) override;
+
   private:
     /// Map to Flows Identifiers to FlowIds
     std::map<FiveTuple, FlowId> m_flowMap;
+    /// Map FlowIds to their key in m_flowMap, whose nodes keep their address
+    std::map<FlowId, const FiveTuple*> m_flowTuples;
     /// Map to FlowIds to FlowPacketId
     std::map<FlowId, FlowPacketId> m_flowPktIdMap;
     /// Map FlowIds to (DSCP value, packet count) pairs
@@ -209,6 +209,7 @@ Ipv6FlowProbe::Ipv6FlowProbe(Ptr<FlowMonitor> monitor,
                              Ptr<Ipv6FlowClassifier> classifier,
                              Ptr<Node> node)
     : FlowProbe(monitor),
+      m_reportInterface(Ipv6::IF_ANY),
       m_classifier(classifier)
 {
     NS_LOG_FUNCTION(this << node->GetId());
@@ -290,6 +291,7 @@ Ipv6FlowProbe::SendOutgoingLogger(const Ipv6Header& ipHeader,
         uint32_t size = (ipPayload->GetSize() + ipHeader.GetSerializedSize());
         NS_LOG_DEBUG("ReportFirstTx (" << this << ", " << flowId << ", " << packetId << ", " << size
                                        << "); " << ipHeader << *ipPayload);
+        m_reportInterface = interface;
         m_flowMonitor->ReportFirstTx(this, flowId, packetId, size);
 
         // tag the packet with the flow id and packet id, so that the packet can be identified even
@@ -315,6 +317,7 @@ Ipv6FlowProbe::ForwardLogger(const Ipv6Header& ipHeader,
         uint32_t size = (ipPayload->GetSize() + ipHeader.GetSerializedSize());
         NS_LOG_DEBUG("ReportForwarding (" << this << ", " << flowId << ", " << packetId << ", "
                                           << size << ");");
+        m_reportInterface = interface;
         m_flowMonitor->ReportForwarding(this, flowId, packetId, size);
     }
 }
@@ -335,6 +338,7 @@ Ipv6FlowProbe::ForwardUpLogger(const Ipv6Header& ipHeader,
         uint32_t size = (ipPayload->GetSize() + ipHeader.GetSerializedSize());
         NS_LOG_DEBUG("ReportLastRx (" << this << ", " << flowId << ", " << packetId << ", " << size
                                       << ");");
+        m_reportInterface = interface;
         m_flowMonitor->ReportLastRx(this, flowId, packetId, size);
     }
 }
@@ -418,6 +422,7 @@ Ipv6FlowProbe::DropLogger(const Ipv6Header& ipHeader,
             NS_FATAL_ERROR("Unexpected drop reason code " << reason);
         }
 
+        m_reportInterface = ifIndex;
         m_flowMonitor->ReportDrop(this, flowId, packetId, size, myReason);
     }
 }
@@ -440,6 +445,7 @@ Ipv6FlowProbe::QueueDropLogger(Ptr<const Packet> ipPayload)
     NS_LOG_DEBUG("Drop (" << this << ", " << flowId << ", " << packetId << ", " << size << ", "
                           << DROP_QUEUE << "); ");
 
+    m_reportInterface = Ipv6::IF_ANY;
     m_flowMonitor->ReportDrop(this, flowId, packetId, size, DROP_QUEUE);
 }
 
@@ -461,6 +467,7 @@ Ipv6FlowProbe::QueueDiscDropLogger(Ptr<const QueueDiscItem> item)
     NS_LOG_DEBUG("Drop (" << this << ", " << flowId << ", " << packetId << ", " << size << ", "
                           << DROP_QUEUE_DISC << "); ");
 
+    m_reportInterface = Ipv6::IF_ANY;
     m_flowMonitor->ReportDrop(this, flowId, packetId, size, DROP_QUEUE_DISC);
 }
 
@@ -90,6 +90,11 @@ class Ipv6FlowProbe : public FlowProbe
   protected:
     void DoDispose() override;
 
+    /// Interface index of the packet event currently being reported to
+    /// the FlowMonitor, or Ipv6::IF_ANY when the event is not bound to an
+    /// interface (e.g., queue drops)
+    uint32_t m_reportInterface;
+
   private:
     /// Log a packet being sent
     /// \param ipHeader IP header
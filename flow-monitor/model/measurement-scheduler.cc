@@ -0,0 +1,199 @@
+// measurement-scheduler.cc
+#include "measurement-scheduler.h"
+
+#include "ns3/abort.h"
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("MeasurementScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED(MeasurementScheduler);
+
+TypeId
+MeasurementScheduler::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::MeasurementScheduler")
+            .SetParent<Object>()
+            .SetGroupName("FlowMonitor")
+            .AddConstructor<MeasurementScheduler>()
+            .AddAttribute("HealthyInterval",
+                          ("Longest interval between two measurements, reached by the "
+                           "healthy classes."),
+                          TimeValue(MilliSeconds(1000)),
+                          MakeTimeAccessor(&MeasurementScheduler::m_healthyInterval),
+                          MakeTimeChecker())
+            .AddAttribute("DegradedInterval",
+                          ("Interval after a degraded measurement of a class whose "
+                           "previous measurement was healthy."),
+                          TimeValue(MilliSeconds(500)),
+                          MakeTimeAccessor(&MeasurementScheduler::m_degradedInterval),
+                          MakeTimeChecker())
+            .AddAttribute("MinInterval",
+                          ("Shortest interval between two measurements."),
+                          TimeValue(MilliSeconds(250)),
+                          MakeTimeAccessor(&MeasurementScheduler::m_minInterval),
+                          MakeTimeChecker())
+            .AddAttribute("SpeedUpFactor",
+                          ("Factor of the interval after each further degraded measurement."),
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&MeasurementScheduler::m_speedUpFactor),
+                          MakeDoubleChecker<double>(0, 1))
+            .AddAttribute("BackOffFactor",
+                          ("Factor of the interval after a healthy measurement."),
+                          DoubleValue(2),
+                          MakeDoubleAccessor(&MeasurementScheduler::m_backOffFactor),
+                          MakeDoubleChecker<double>(1))
+            .AddAttribute("StopTime",
+                          ("No measurement is scheduled after this time, and the simulation "
+                           "is stopped at this time once no class is left measuring.  "
+                           "Zero measures until the simulation ends."),
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&MeasurementScheduler::m_stopTime),
+                          MakeTimeChecker())
+            .AddAttribute("RelativeThroughputThreshold",
+                          ("Decrease of the throughput, relative to the baseline, that is "
+                           "a degradation."),
+                          DoubleValue(0.5),
+                          MakeDoubleAccessor(&MeasurementScheduler::m_throughputThreshold),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("RelativeDelayThreshold",
+                          ("Increase of the delay, relative to the baseline, that is "
+                           "a degradation."),
+                          DoubleValue(0.1),
+                          MakeDoubleAccessor(&MeasurementScheduler::m_delayThreshold),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("RelativeJitterThreshold",
+                          ("Increase of the jitter, relative to the baseline, that is "
+                           "a degradation."),
+                          DoubleValue(0.1),
+                          MakeDoubleAccessor(&MeasurementScheduler::m_jitterThreshold),
+                          MakeDoubleChecker<double>(0));
+    return tid;
+}
+
+MeasurementScheduler::MeasurementScheduler()
+    : m_scheduledClasses(0)
+{
+    NS_LOG_FUNCTION(this);
+}
+
+MeasurementScheduler::~MeasurementScheduler()
+{
+    NS_LOG_FUNCTION(this);
+}
+
+void
+MeasurementScheduler::DoDispose()
+{
+    NS_LOG_FUNCTION(this);
+    for (MeasuredClass& measuredClass : m_classes)
+    {
+        measuredClass.event.Cancel();
+        measuredClass.measure = MakeNullCallback<bool, uint32_t, Time>();
+    }
+    m_classes.clear();
+    m_scheduledClasses = 0;
+    Object::DoDispose();
+}
+
+uint32_t
+MeasurementScheduler::AddClass(MeasureCallback measure, Time start)
+{
+    NS_LOG_FUNCTION(this << start);
+    uint32_t classId = m_classes.size();
+    m_classes.push_back(MeasuredClass{measure, m_healthyInterval, start, 0, EventId()});
+    Time first = start + m_healthyInterval;
+    if (!m_stopTime.IsZero() && first > m_stopTime)
+    {
+        return classId;
+    }
+    m_classes[classId].event = Simulator::Schedule(first - Simulator::Now(),
+                                                   &MeasurementScheduler::Measure,
+                                                   this,
+                                                   classId);
+    ++m_scheduledClasses;
+    return classId;
+}
+
+Time
+MeasurementScheduler::GetInterval(uint32_t classId) const
+{
+    NS_ABORT_MSG_IF(classId >= m_classes.size(), "Unknown class " << classId);
+    return m_classes[classId].interval;
+}
+
+uint32_t
+MeasurementScheduler::GetMeasurements(uint32_t classId) const
+{
+    NS_ABORT_MSG_IF(classId >= m_classes.size(), "Unknown class " << classId);
+    return m_classes[classId].measurements;
+}
+
+double
+MeasurementScheduler::GetRelativeThroughputThreshold() const
+{
+    return m_throughputThreshold;
+}
+
+double
+MeasurementScheduler::GetRelativeDelayThreshold() const
+{
+    return m_delayThreshold;
+}
+
+double
+MeasurementScheduler::GetRelativeJitterThreshold() const
+{
+    return m_jitterThreshold;
+}
+
+Time
+MeasurementScheduler::NextInterval(bool degraded, Time interval) const
+{
+    if (!degraded)
+    {
+        return std::min(m_healthyInterval, interval * m_backOffFactor);
+    }
+    if (interval > m_degradedInterval)
+    {
+        return std::max(m_minInterval, m_degradedInterval);
+    }
+    return std::max(m_minInterval, interval * m_speedUpFactor);
+}
+
+void
+MeasurementScheduler::Measure(uint32_t classId)
+{
+    NS_LOG_FUNCTION(this << classId);
+    // The callback reads the interval of the measured period
+    bool degraded = m_classes[classId].measure(classId, m_classes[classId].lastMeasurement);
+
+    MeasuredClass& measuredClass = m_classes[classId];
+    ++measuredClass.measurements;
+    measuredClass.lastMeasurement = Simulator::Now();
+    measuredClass.interval = NextInterval(degraded, measuredClass.interval);
+    NS_LOG_DEBUG("Class " << classId << (degraded ? " degraded" : " healthy")
+                          << ", next measurement in " << measuredClass.interval.As(Time::MS));
+
+    if (m_stopTime.IsZero() || Simulator::Now() + measuredClass.interval <= m_stopTime)
+    {
+        measuredClass.event = Simulator::Schedule(measuredClass.interval,
+                                                  &MeasurementScheduler::Measure,
+                                                  this,
+                                                  classId);
+        return;
+    }
+    if (--m_scheduledClasses == 0)
+    {
+        Simulator::Stop(std::max(Time(0), m_stopTime - Simulator::Now()));
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,109 @@
+// measurement-scheduler.h
+#ifndef MEASUREMENT_SCHEDULER_H
+#define MEASUREMENT_SCHEDULER_H
+
+#include "ns3/callback.h"
+#include "ns3/event-id.h"
+#include "ns3/nstime.h"
+#include "ns3/object.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+/// \ingroup flow-monitor
+/// \brief Schedules the periodic measurements of flow classes, at a cadence
+/// following their health
+///
+/// Every class (a monitor, or a class of its flows) has its own measurement
+/// interval.  A measurement reporting a degradation moves the class to
+/// DegradedInterval, and each further degraded measurement shortens the
+/// interval by SpeedUpFactor, down to MinInterval.  Healthy measurements
+/// lengthen it by BackOffFactor, up to HealthyInterval.  Healthy classes are
+/// thus sampled rarely and degraded ones often.
+///
+/// With a StopTime, a class stops measuring when its next measurement would
+/// come after it, and the simulation is stopped at StopTime once no class is
+/// left measuring.
+///
+/// The Relative*Threshold attributes are the relative deviations from the
+/// baseline of a class that the measurements should report as degradations.
+class MeasurementScheduler : public Object
+{
+public:
+    /// \brief Callback measuring a class
+    /// The arguments are the class ID and the time of the previous
+    /// measurement of the class, or its start time.  Returns true if the
+    /// class is degraded.
+    typedef Callback<bool, uint32_t, Time> MeasureCallback;
+
+    MeasurementScheduler();
+    ~MeasurementScheduler() override;
+
+    /// Register this type.
+    /// \return The TypeId.
+    static TypeId GetTypeId();
+
+    /// \brief Add a class to measure
+    /// \param measure the callback measuring the class
+    /// \param start the start of the first measured period; the first
+    /// measurement is HealthyInterval later
+    /// \returns the ID of the class
+    uint32_t AddClass(MeasureCallback measure, Time start);
+
+    /// \param classId the ID of a class
+    /// \returns the interval until the next measurement of the class
+    Time GetInterval(uint32_t classId) const;
+
+    /// \param classId the ID of a class
+    /// \returns the number of measurements of the class so far
+    uint32_t GetMeasurements(uint32_t classId) const;
+
+    /// \returns the relative throughput decrease that is a degradation
+    double GetRelativeThroughputThreshold() const;
+    /// \returns the relative delay increase that is a degradation
+    double GetRelativeDelayThreshold() const;
+    /// \returns the relative jitter increase that is a degradation
+    double GetRelativeJitterThreshold() const;
+
+protected:
+    void DoDispose() override;
+
+private:
+    /// Measurement state of a class
+    struct MeasuredClass
+    {
+        MeasureCallback measure; //!< measures the class
+        Time interval;           //!< interval until the next measurement
+        Time lastMeasurement;    //!< time of the previous measurement, or the start
+        uint32_t measurements;   //!< measurements so far
+        EventId event;           //!< next measurement
+    };
+
+    /// \brief Measure a class and schedule its next measurement
+    /// \param classId the ID of the class
+    void Measure(uint32_t classId);
+
+    /// \param degraded the result of a measurement
+    /// \param interval the interval before the measurement
+    /// \returns the interval until the next measurement
+    Time NextInterval(bool degraded, Time interval) const;
+
+    Time m_healthyInterval;       //!< interval of the healthy classes
+    Time m_degradedInterval;      //!< interval after a first degraded measurement
+    Time m_minInterval;           //!< shortest interval
+    double m_speedUpFactor;       //!< interval factor of a further degraded measurement
+    double m_backOffFactor;       //!< interval factor of a healthy measurement
+    Time m_stopTime;              //!< no measurement after this time, zero for none
+    double m_throughputThreshold; //!< relative throughput decrease that is a degradation
+    double m_delayThreshold;      //!< relative delay increase that is a degradation
+    double m_jitterThreshold;     //!< relative jitter increase that is a degradation
+
+    std::vector<MeasuredClass> m_classes; //!< classes, by ID
+    uint32_t m_scheduledClasses;          //!< classes with a next measurement
+};
+
+} // namespace ns3
+
+#endif /* MEASUREMENT_SCHEDULER_H */
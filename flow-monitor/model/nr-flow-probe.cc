@@ -0,0 +1,290 @@
+#include "nr-flow-probe.h"
+#include "flow-monitor.h"
+#include "ipv4-flow-probe.h"
+
+#include "ns3/config.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <sstream>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("NrFlowProbe");
+
+/// Size of the PDCP header of the data radio bearers (LtePdcpHeader)
+const uint32_t PDCP_HEADER_SIZE = 2;
+/// UDP and GTP-U headers put in front of an UL SDU by the gNB, inside the
+/// IPv4 payload of the S1-U packet
+const uint32_t GTPU_OVERHEAD = 8 + 8;
+
+NrFlowProbe::NrFlowProbe(Ptr<FlowMonitor> monitor, Ptr<Node> node)
+    : FlowProbe(monitor),
+      BigBrotherHopStore(node->GetId()),
+      m_perPacketStats{}
+{
+    NS_LOG_FUNCTION(this << node->GetId());
+
+    std::ostringstream ue;
+    ue << "/NodeList/" << m_nodeId
+       << "/DeviceList/*/$ns3::NrUeNetDevice/LteUeRrc/ConnectionReconfiguration";
+    Config::ConnectWithoutContextFailSafe(
+        ue.str(),
+        MakeCallback(&NrFlowProbe::ConnectBearers, Ptr<NrFlowProbe>(this)));
+    std::ostringstream gnb;
+    gnb << "/NodeList/" << m_nodeId
+        << "/DeviceList/*/$ns3::NrGnbNetDevice/LteEnbRrc/ConnectionReconfiguration";
+    Config::ConnectWithoutContextFailSafe(
+        gnb.str(),
+        MakeCallback(&NrFlowProbe::ConnectBearers, Ptr<NrFlowProbe>(this)));
+
+    // UE: DL SDUs are delivered locally.  gNB: UL SDUs leave through the S1-U tunnel.
+    Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+    if (ipv4)
+    {
+        if (!ipv4->TraceConnectWithoutContext(
+                "LocalDeliver",
+                MakeCallback(&NrFlowProbe::LocalDeliverLogger, Ptr<NrFlowProbe>(this))))
+        {
+            NS_FATAL_ERROR("NrFlowProbe can't connect to Ipv4L3Protocol::LocalDeliver of node "
+                           << m_nodeId);
+        }
+        if (!ipv4->TraceConnectWithoutContext(
+                "SendOutgoing",
+                MakeCallback(&NrFlowProbe::SendOutgoingLogger, Ptr<NrFlowProbe>(this))))
+        {
+            NS_FATAL_ERROR("NrFlowProbe can't connect to Ipv4L3Protocol::SendOutgoing of node "
+                           << m_nodeId);
+        }
+    }
+}
+
+NrFlowProbe::~NrFlowProbe()
+{
+}
+
+/* static */
+TypeId
+NrFlowProbe::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::NrFlowProbe").SetParent<FlowProbe>().SetGroupName("FlowMonitor")
+        // No AddConstructor because this class has no default constructor.
+        ;
+    return tid;
+}
+
+void
+NrFlowProbe::DoDispose()
+{
+    m_connected.clear();
+    FlowProbe::DoDispose();
+}
+
+const std::map<NrFlowProbe::BearerId, NrFlowProbe::BearerStats>&
+NrFlowProbe::GetBearerStats() const
+{
+    return m_bearerStats;
+}
+
+const std::map<FlowId, NrFlowProbe::FlowRadioStats>&
+NrFlowProbe::GetFlowRadioStats() const
+{
+    return m_flowRadioStats;
+}
+
+void
+NrFlowProbe::ClearPerPacketStats()
+{
+    BigBrotherHopStore::ClearPerPacketStats();
+    m_perPacketStats.clear();
+    m_bearerStats.clear();
+    // The flows keep their entry, so the reports don't allocate them again
+    for (auto& [flowId, stats] : m_flowRadioStats)
+    {
+        stats = FlowRadioStats();
+    }
+}
+
+uint32_t
+NrFlowProbe::GetFeatures() const
+{
+    return bigbrother::PerHop::mask;
+}
+
+void
+NrFlowProbe::ForgetFlow(FlowId flowId)
+{
+    FlowProbe::ForgetFlow(flowId);
+    auto first = std::make_pair(flowId, FlowPacketId(0));
+    auto last = std::make_pair(flowId + 1, FlowPacketId(0));
+    m_perPacketStats.erase(m_perPacketStats.lower_bound(first), m_perPacketStats.lower_bound(last));
+    m_flowRadioStats.erase(flowId);
+}
+
+void
+NrFlowProbe::ConnectBearers(uint64_t imsi, uint16_t cellId, uint16_t rnti)
+{
+    NS_LOG_FUNCTION(this << imsi << cellId << rnti);
+
+    std::ostringstream base;
+    base << "/NodeList/" << m_nodeId << "/DeviceList/*/";
+    const std::string drbPaths[] = {
+        base.str() + "$ns3::NrUeNetDevice/LteUeRrc/DataRadioBearerMap/*/",
+        base.str() + "$ns3::NrGnbNetDevice/LteEnbRrc/UeMap/*/DataRadioBearerMap/*/",
+    };
+    for (const std::string& drbPath : drbPaths)
+    {
+        Config::MatchContainer pdcps = Config::LookupMatches(drbPath + "LtePdcp");
+        for (auto it = pdcps.Begin(); it != pdcps.End(); ++it)
+        {
+            if (m_connected.insert(*it).second)
+            {
+                (*it)->TraceConnectWithoutContext(
+                    "TxPDU",
+                    MakeCallback(&NrFlowProbe::PdcpTxLogger, Ptr<NrFlowProbe>(this)));
+                (*it)->TraceConnectWithoutContext(
+                    "RxPDU",
+                    MakeCallback(&NrFlowProbe::PdcpRxLogger, Ptr<NrFlowProbe>(this)));
+            }
+        }
+        Config::MatchContainer rlcs = Config::LookupMatches(drbPath + "LteRlc");
+        for (auto it = rlcs.Begin(); it != rlcs.End(); ++it)
+        {
+            if (m_connected.insert(*it).second)
+            {
+                (*it)->TraceConnectWithoutContext(
+                    "TxPDU",
+                    MakeCallback(&NrFlowProbe::RlcTxLogger, Ptr<NrFlowProbe>(this)));
+                (*it)->TraceConnectWithoutContext(
+                    "RxPDU",
+                    MakeCallback(&NrFlowProbe::RlcRxLogger, Ptr<NrFlowProbe>(this)));
+            }
+        }
+    }
+}
+
+void
+NrFlowProbe::PdcpTxLogger(uint16_t rnti, uint8_t lcid, uint32_t size)
+{
+    BearerStats& stats = m_bearerStats[BearerId(rnti, lcid)];
+    stats.txPdcpBytes += size;
+    ++stats.txPdcpPdus;
+}
+
+void
+NrFlowProbe::PdcpRxLogger(uint16_t rnti, uint8_t lcid, uint32_t size, uint64_t delay)
+{
+    BearerId bearer(rnti, lcid);
+    BearerStats& stats = m_bearerStats[bearer];
+    stats.rxPdcpBytes += size;
+    ++stats.rxPdcpPdus;
+    stats.rxPdcpDelaySum += NanoSeconds(delay);
+
+    // SDUs not seen at IPv4 within their event (e.g., not IPv4) are forgotten
+    Time now = Simulator::Now();
+    if (!m_pending.empty() && m_pending.front().time != now)
+    {
+        m_pending.clear();
+    }
+    auto rlc = m_lastRlcDelay.find(bearer);
+    m_pending.push_back(PendingSdu{now,
+                                   bearer,
+                                   NanoSeconds(delay),
+                                   rlc != m_lastRlcDelay.end() ? rlc->second : Time(0),
+                                   size});
+}
+
+void
+NrFlowProbe::RlcTxLogger(uint16_t rnti, uint8_t lcid, uint32_t size)
+{
+    BearerStats& stats = m_bearerStats[BearerId(rnti, lcid)];
+    stats.txRlcBytes += size;
+    ++stats.txRlcPdus;
+}
+
+void
+NrFlowProbe::RlcRxLogger(uint16_t rnti, uint8_t lcid, uint32_t size, uint64_t delay)
+{
+    BearerId bearer(rnti, lcid);
+    BearerStats& stats = m_bearerStats[bearer];
+    stats.rxRlcDelaySum += NanoSeconds(delay);
+    ++stats.rxRlcPdus;
+    m_lastRlcDelay[bearer] = NanoSeconds(delay);
+}
+
+void
+NrFlowProbe::LocalDeliverLogger(const Ipv4Header& ipHeader,
+                                Ptr<const Packet> ipPayload,
+                                uint32_t interface)
+{
+    uint32_t packetSize = ipHeader.GetSerializedSize() + ipPayload->GetSize();
+    RecordIpv4Packet(ipPayload, packetSize, packetSize);
+}
+
+void
+NrFlowProbe::SendOutgoingLogger(const Ipv4Header& ipHeader,
+                                Ptr<const Packet> ipPayload,
+                                uint32_t interface)
+{
+    // Only a packet tunneled through S1-U can come from an SDU
+    uint32_t packetSize = ipHeader.GetSerializedSize() + ipPayload->GetSize();
+    uint32_t sduSize = ipPayload->GetSize() >= GTPU_OVERHEAD ? ipPayload->GetSize() - GTPU_OVERHEAD : 0;
+    RecordIpv4Packet(ipPayload, packetSize, sduSize);
+}
+
+void
+NrFlowProbe::RecordIpv4Packet(Ptr<const Packet> ipPayload, uint32_t packetSize, uint32_t sduSize)
+{
+    FlowId flowId;
+    FlowPacketId packetId;
+    if (!Ipv4FlowProbe::PeekFlowIdentifiers(ipPayload, &flowId, &packetId))
+    {
+        return;
+    }
+
+    // Packets already received by an Ipv4FlowProbe of the node are no longer in flight
+    Time delayFromFirstProbe;
+    if (m_flowMonitor->GetDelayFromFirstProbe(flowId, packetId, &delayFromFirstProbe) &&
+        RecordHop(flowId, packetId, packetSize, delayFromFirstProbe))
+    {
+        m_flowMonitor->AddFlowObserver(flowId, this);
+    }
+
+    // The PDCP SDU reaches IPv4 within the same event it was received in
+    Time now = Simulator::Now();
+    auto pending = std::find_if(m_pending.begin(), m_pending.end(), [&](const PendingSdu& sdu) {
+        return sdu.time == now && sdu.bytes == sduSize + PDCP_HEADER_SIZE;
+    });
+    if (pending == m_pending.end())
+    {
+        return;
+    }
+
+    // The RLC delay can exceed the PDCP one when RLC retransmissions keep the
+    // original timestamp; all of it is then accounted as air delay
+    Time airDelay = std::min(pending->rlcDelay, pending->pdcpDelay);
+    auto insert = m_perPacketStats.emplace(std::make_pair(flowId, packetId),
+                                           RadioSegmentStats{pending->pdcpDelay - airDelay,
+                                                             airDelay,
+                                                             pending->bytes});
+    if (!insert.second)
+    {
+        NS_LOG_WARN("Radio segment of (" << flowId << "," << packetId << ") already recorded");
+    }
+    else
+    {
+        FlowRadioStats& flowStats = m_flowRadioStats[flowId];
+        flowStats.bufferWaitSum += insert.first->second.bufferWait;
+        flowStats.airDelaySum += insert.first->second.airDelay;
+        ++flowStats.packets;
+    }
+    m_pending.erase(pending);
+}
+
+} // namespace ns3
@@ -0,0 +1,186 @@
+// nr-flow-probe.h
+#ifndef NR_FLOW_PROBE_H
+#define NR_FLOW_PROBE_H
+
+#include "big-brother-flow-probe.h"
+#include "flow-probe.h"
+
+#include "ns3/ipv4-header.h"
+
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+class FlowMonitor;
+class Node;
+
+/// \ingroup flow-monitor
+/// \brief Class that splits the radio segment of a packet's path at an NR node
+///
+/// The probe hooks the PDCP and RLC trace sources of the data radio bearers
+/// of the NR devices (UE or gNB) of a node, the same sources read by
+/// NrHelper::EnableTraces(), but keeps the measurements in memory instead of
+/// writing text trace files.
+///
+/// On the receiving side of the radio link (the UE in DL, the gNB in UL), the
+/// PDCP delay of every SDU is split into:
+///  - air delay: the RLC delay of the RLC PDU completing the SDU, i.e., from
+///    the MAC transmission opportunity at the peer up to the reception here;
+///  - buffer wait: the rest of the PDCP delay, spent queued at the peer's RLC.
+///
+/// The SDU is handed up synchronously to IPv4 (LocalDeliver at the UE,
+/// SendOutgoing through the S1-U tunnel at the gNB), where the tag left by the
+/// Ipv4FlowProbes gives its (FlowId, FlowPacketId).  The pending SDU is only
+/// attributed to an IPv4 packet of the same event and of the same size.
+/// Records use the same key as the hops of BigBrotherHopStore::m_flowHops, so
+/// they can be joined with the per-hop data of the node.
+///
+/// The probe also records, as a BigBrotherHopStore, the hop of every packet in
+/// flight crossing the IPv4 layer of the node.  On a gNB, which has no
+/// Ipv4FlowProbe since it only tunnels the packets, these are the hops that
+/// split the path of a packet into its radio and EPC segments for
+/// the node-to-node analysis.
+///
+/// Only the trace source names are used, so the flow-monitor module does not
+/// need to link with the lte or nr modules.
+class NrFlowProbe : public FlowProbe, public BigBrotherHopStore
+{
+public:
+    /// Radio segment of a single packet, as seen by this probe
+    struct RadioSegmentStats
+    {
+        Time bufferWait; //!< time queued at the transmitter's RLC
+        Time airDelay;   //!< time from RLC transmission up to the reception
+        uint32_t bytes;  //!< size of the PDCP PDU
+    };
+
+    /// PDCP and RLC counters of one radio bearer
+    struct BearerStats
+    {
+        uint64_t txPdcpBytes = 0; //!< bytes of the PDCP PDUs sent
+        uint32_t txPdcpPdus = 0;  //!< PDCP PDUs sent
+        uint64_t txRlcBytes = 0;  //!< bytes of the RLC PDUs sent
+        uint32_t txRlcPdus = 0;   //!< RLC PDUs sent
+        uint64_t rxPdcpBytes = 0; //!< bytes of the PDCP PDUs received
+        uint32_t rxPdcpPdus = 0;  //!< PDCP PDUs received
+        Time rxPdcpDelaySum;      //!< sum of the PDCP delays received
+        Time rxRlcDelaySum;       //!< sum of the RLC delays received
+        uint32_t rxRlcPdus = 0;   //!< RLC PDUs received
+    };
+
+    /// Radio segments of the packets of a flow received by this probe since
+    /// the last ClearPerPacketStats()
+    struct FlowRadioStats
+    {
+        Time bufferWaitSum;   //!< sum of the buffer waits
+        Time airDelaySum;     //!< sum of the air delays
+        uint32_t packets = 0; //!< packets whose radio segment was split
+    };
+
+    /// Bearers are identified by (RNTI, logical channel id)
+    typedef std::pair<uint16_t, uint8_t> BearerId;
+
+    // Container to map <FlowId, PacketId> -> radio segment stats
+    typedef std::map<std::pair<FlowId, FlowPacketId>, RadioSegmentStats> PerPacketRadioStats;
+    PerPacketRadioStats m_perPacketStats;
+
+    /// \param monitor the FlowMonitor this probe is associated with
+    /// \param node the Node this probe is associated with
+    NrFlowProbe(Ptr<FlowMonitor> monitor, Ptr<Node> node);
+    ~NrFlowProbe() override;
+
+    /// \returns the PDCP and RLC counters of every bearer seen so far
+    const std::map<BearerId, BearerStats>& GetBearerStats() const;
+
+    /// \returns the radio segments of every flow received by this probe, summed
+    /// since the last ClearPerPacketStats()
+    const std::map<FlowId, FlowRadioStats>& GetFlowRadioStats() const;
+
+    /// Clear the per-packet records, the hops and the bearer counters, and
+    /// zero the per-flow radio sums
+    void ClearPerPacketStats() override;
+
+    void ForgetFlow(FlowId flowId) override;
+
+    uint32_t GetFeatures() const override;
+
+    /// Register this type.
+    /// \return The TypeId.
+    static TypeId GetTypeId();
+
+protected:
+    void DoDispose() override;
+
+private:
+    /// Connect to the PDCP and RLC of the bearers not yet hooked.  Bearers
+    /// are created on RRC connection (re)configuration, hence the signature.
+    /// \param imsi the IMSI
+    /// \param cellId the cell ID
+    /// \param rnti the RNTI
+    void ConnectBearers(uint64_t imsi, uint16_t cellId, uint16_t rnti);
+
+    /// Log a PDCP PDU sent
+    /// \param rnti the RNTI
+    /// \param lcid the logical channel id
+    /// \param size the PDU size
+    void PdcpTxLogger(uint16_t rnti, uint8_t lcid, uint32_t size);
+    /// Log a PDCP PDU received, and keep it pending until its SDU reaches IPv4
+    /// \param rnti the RNTI
+    /// \param lcid the logical channel id
+    /// \param size the PDU size
+    /// \param delay the PDCP delay, in nanoseconds
+    void PdcpRxLogger(uint16_t rnti, uint8_t lcid, uint32_t size, uint64_t delay);
+    /// Log a RLC PDU sent
+    /// \param rnti the RNTI
+    /// \param lcid the logical channel id
+    /// \param size the PDU size
+    void RlcTxLogger(uint16_t rnti, uint8_t lcid, uint32_t size);
+    /// Log a RLC PDU received
+    /// \param rnti the RNTI
+    /// \param lcid the logical channel id
+    /// \param size the PDU size
+    /// \param delay the RLC delay, in nanoseconds
+    void RlcRxLogger(uint16_t rnti, uint8_t lcid, uint32_t size, uint64_t delay);
+    /// Log a packet delivered locally: a DL SDU at the UE, or a DL packet
+    /// coming out of the S1-U tunnel at the gNB
+    /// \param ipHeader IPv4 header
+    /// \param ipPayload IPv4 payload
+    /// \param interface incoming interface
+    void LocalDeliverLogger(const Ipv4Header& ipHeader, Ptr<const Packet> ipPayload, uint32_t interface);
+    /// Log a packet sent: an UL SDU going into the S1-U tunnel at the gNB, or
+    /// an UL packet at the UE
+    /// \param ipHeader IPv4 header
+    /// \param ipPayload IPv4 payload
+    /// \param interface outgoing interface
+    void SendOutgoingLogger(const Ipv4Header& ipHeader, Ptr<const Packet> ipPayload, uint32_t interface);
+    /// Record the hop of a tagged packet, and attribute it the pending PDCP SDU
+    /// of its size, if any
+    /// \param ipPayload IPv4 payload, carrying the tag of the Ipv4FlowProbes
+    /// \param packetSize size of the IPv4 packet
+    /// \param sduSize size of the PDCP SDU the packet would come from
+    void RecordIpv4Packet(Ptr<const Packet> ipPayload, uint32_t packetSize, uint32_t sduSize);
+
+    /// PDCP SDU received and not yet seen at IPv4
+    struct PendingSdu
+    {
+        Time time;          //!< reception time
+        BearerId bearer;    //!< bearer the SDU was received on
+        Time pdcpDelay;     //!< PDCP delay of the SDU
+        Time rlcDelay;      //!< RLC delay of the last RLC PDU of the bearer
+        uint32_t bytes = 0; //!< size of the PDCP PDU
+    };
+
+    std::vector<PendingSdu> m_pending;        //!< PDCP SDUs received in the current event
+    std::map<BearerId, Time> m_lastRlcDelay;  //!< RLC delay of the last RLC PDU per bearer
+    std::map<BearerId, BearerStats> m_bearerStats; //!< per-bearer counters
+    std::map<FlowId, FlowRadioStats> m_flowRadioStats; //!< per-flow radio sums
+    std::set<Ptr<Object>> m_connected;        //!< PDCP and RLC entities already hooked
+};
+
+} // namespace ns3
+
+#endif /* NR_FLOW_PROBE_H */
@@ -0,0 +1,165 @@
+#include "tcp-rtt-flow-probe.h"
+#include "flow-monitor.h"
+
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("TcpRttFlowProbe");
+
+/// TCP protocol number
+static const uint8_t TCP_PROT_NUMBER = 6;
+
+TcpRttFlowProbe::TcpRttFlowProbe(Ptr<FlowMonitor> monitor,
+                                 Ptr<Ipv4FlowClassifier> classifier,
+                                 Ptr<Node> node)
+    : FlowProbe(monitor),
+      m_classifier(classifier)
+{
+    NS_LOG_FUNCTION(this << node->GetId());
+
+    Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+    if (!ipv4)
+    {
+        return;
+    }
+    for (const char* source : {"SendOutgoing", "UnicastForward", "LocalDeliver"})
+    {
+        if (!ipv4->TraceConnectWithoutContext(
+                source,
+                MakeCallback(&TcpRttFlowProbe::Ipv4Logger, Ptr<TcpRttFlowProbe>(this))))
+        {
+            NS_FATAL_ERROR("TcpRttFlowProbe can't connect to Ipv4L3Protocol::"
+                           << source << " of node " << node->GetId());
+        }
+    }
+}
+
+TcpRttFlowProbe::~TcpRttFlowProbe()
+{
+}
+
+/* static */
+TypeId
+TcpRttFlowProbe::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::TcpRttFlowProbe").SetParent<FlowProbe>().SetGroupName("FlowMonitor")
+        // No AddConstructor because this class has no default constructor.
+        ;
+    return tid;
+}
+
+void
+TcpRttFlowProbe::DoDispose()
+{
+    m_classifier = nullptr;
+    FlowProbe::DoDispose();
+}
+
+const std::map<FlowId, TcpRttFlowProbe::RttStats>&
+TcpRttFlowProbe::GetRttStats() const
+{
+    return m_rttStats;
+}
+
+void
+TcpRttFlowProbe::ClearPerPacketStats()
+{
+    m_rttStats.clear();
+}
+
+void
+TcpRttFlowProbe::ForgetFlow(FlowId flowId)
+{
+    FlowProbe::ForgetFlow(flowId);
+    m_pending.erase(flowId);
+    m_rttStats.erase(flowId);
+}
+
+void
+TcpRttFlowProbe::Ipv4Logger(const Ipv4Header& ipHeader,
+                            Ptr<const Packet> ipPayload,
+                            uint32_t interface)
+{
+    FlowId flowId;
+    if (ipHeader.GetProtocol() != TCP_PROT_NUMBER ||
+        !m_classifier->LookupFlow(ipHeader, ipPayload, &flowId))
+    {
+        return;
+    }
+    TcpHeader tcpHeader;
+    ipPayload->PeekHeader(tcpHeader);
+    uint8_t flags = tcpHeader.GetFlags();
+    Time now = Simulator::Now();
+
+    // SYN and FIN take one sequence number each
+    uint32_t length = ipPayload->GetSize() - tcpHeader.GetSerializedSize();
+    length += (flags & TcpHeader::SYN) ? 1 : 0;
+    length += (flags & TcpHeader::FIN) ? 1 : 0;
+    if (length > 0)
+    {
+        SequenceNumber32 end = tcpHeader.GetSequenceNumber() + static_cast<int32_t>(length);
+        auto insert = m_pending.try_emplace(flowId);
+        PendingSegments& pending = insert.first->second;
+        if (!insert.second && end <= pending.highestEnd)
+        {
+            // Karn: the ACKs of the pending segments are now ambiguous
+            pending.segments.clear();
+        }
+        else
+        {
+            pending.segments.push_back(Segment{end, now});
+            pending.highestEnd = end;
+        }
+    }
+
+    if (!(flags & TcpHeader::ACK))
+    {
+        return;
+    }
+    FlowId dataFlowId = m_classifier->GetReverseFlow(flowId);
+    auto pending = m_pending.find(dataFlowId);
+    if (dataFlowId == 0 || pending == m_pending.end())
+    {
+        return;
+    }
+    // A cumulative ACK gives a single sample, from the newest segment it covers
+    std::deque<Segment>& segments = pending->second.segments;
+    SequenceNumber32 ack = tcpHeader.GetAckNumber();
+    bool covered = false;
+    Time seen;
+    while (!segments.empty() && segments.front().end <= ack)
+    {
+        covered = true;
+        seen = segments.front().seen;
+        segments.pop_front();
+    }
+    if (!covered)
+    {
+        return;
+    }
+
+    Time rtt = now - seen;
+    auto insert = m_rttStats.try_emplace(dataFlowId);
+    RttStats& stats = insert.first->second;
+    if (insert.second)
+    {
+        stats.minRtt = rtt;
+        stats.rttHistogram.SetDefaultBinWidth(0.001);
+    }
+    ++stats.samples;
+    stats.rttSum += rtt;
+    stats.minRtt = std::min(stats.minRtt, rtt);
+    stats.maxRtt = std::max(stats.maxRtt, rtt);
+    stats.rttHistogram.AddValue(rtt.GetSeconds());
+}
+
+} // namespace ns3
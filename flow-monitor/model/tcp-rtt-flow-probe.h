@@ -0,0 +1,102 @@
+// tcp-rtt-flow-probe.h
+#ifndef TCP_RTT_FLOW_PROBE_H
+#define TCP_RTT_FLOW_PROBE_H
+
+#include "flow-probe.h"
+#include "ipv4-flow-classifier.h"
+
+#include "ns3/histogram.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/tcp-header.h"
+
+#include <deque>
+#include <map>
+#include <unordered_map>
+
+namespace ns3
+{
+
+class FlowMonitor;
+class Node;
+
+/// \ingroup flow-monitor
+/// \brief Class that passively estimates the RTT of the TCP conversations
+/// crossing the IPv4 layer of a node
+///
+/// Every new data segment of a flow is timestamped when it crosses the node
+/// (sent, forwarded or received), and the first ACK of the reverse flow
+/// covering it gives an RTT sample.  The two directions are paired by
+/// Ipv4FlowClassifier::GetReverseFlow().  Following Karn's algorithm, a
+/// retransmission discards the samples of the segments still pending.
+///
+/// The RTT is measured from this node: it is the full RTT at the sender,
+/// and the part of the path from this node to the receiver and back at any
+/// node in the middle.
+///
+/// Packets are only looked up, not classified, so the IPv4 probes of the
+/// FlowMonitor must see the conversations at their sources.
+class TcpRttFlowProbe : public FlowProbe
+{
+public:
+    /// RTT samples of a conversation
+    struct RttStats
+    {
+        uint32_t samples = 0;   //!< number of RTT samples
+        Time rttSum;            //!< sum of the RTT samples
+        Time minRtt;            //!< lowest RTT sample
+        Time maxRtt;            //!< highest RTT sample
+        Histogram rttHistogram; //!< histogram of the RTT samples, in seconds
+    };
+
+    /// \param monitor the FlowMonitor this probe is associated with
+    /// \param classifier the Ipv4FlowClassifier of the IPv4 probes
+    /// \param node the Node this probe is associated with
+    TcpRttFlowProbe(Ptr<FlowMonitor> monitor,
+                    Ptr<Ipv4FlowClassifier> classifier,
+                    Ptr<Node> node);
+    ~TcpRttFlowProbe() override;
+
+    /// \returns the RTT stats, keyed on the FlowId of the data direction
+    const std::map<FlowId, RttStats>& GetRttStats() const;
+
+    /// Clear the RTT stats, keeping the segments waiting for their ACK
+    void ClearPerPacketStats() override;
+
+    void ForgetFlow(FlowId flowId) override;
+
+    /// Register this type.
+    /// \return The TypeId.
+    static TypeId GetTypeId();
+
+protected:
+    void DoDispose() override;
+
+private:
+    /// Timestamp the data segments and match the ACKs crossing the node
+    /// \param ipHeader IPv4 header
+    /// \param ipPayload IPv4 payload
+    /// \param interface interface of the packet
+    void Ipv4Logger(const Ipv4Header& ipHeader, Ptr<const Packet> ipPayload, uint32_t interface);
+
+    /// Data segment waiting for its ACK
+    struct Segment
+    {
+        SequenceNumber32 end; //!< sequence number following the segment
+        Time seen;            //!< time the segment crossed the node
+    };
+
+    /// Data segments of a flow waiting for their ACK
+    struct PendingSegments
+    {
+        std::deque<Segment> segments; //!< segments, in sequence order
+        SequenceNumber32 highestEnd;  //!< highest end seen, to detect retransmissions
+    };
+
+    Ptr<Ipv4FlowClassifier> m_classifier;                  //!< classifier of the IPv4 probes
+    std::unordered_map<FlowId, PendingSegments> m_pending; //!< data flow --> pending segments
+    std::map<FlowId, RttStats> m_rttStats;                 //!< data flow --> RTT stats
+};
+
+} // namespace ns3
+
+#endif /* TCP_RTT_FLOW_PROBE_H */
@@ -0,0 +1,187 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Counts the heap allocations of the simulation thread during the flow reports,
+// driven by a MeasurementScheduler as in topology_1_3. Before every report, the stats
+// are read as the report reads them: snapshotFlowReport and computeFlowKpis, into a
+// session of their own with its own detector, so the report's baselines don't move.
+// Once its buffers have grown, reading the stats must not allocate at all. The whole
+// reportFlowStats call is counted too. With ANALYSIS_THREADS, the files are formatted
+// and written by the report writer thread, whose allocations are not counted. Copying
+// the stats, as the reports did before, is counted for comparison.
+//
+// n0 --- n1 --- n2, UDP flows and a TCP transfer from n0 to n2, probes on every node.
+// The degradation thresholds are out of reach, so no node-to-node trigger runs: its
+// snapshot is measured by node-to-node-benchmark. Exits with 1 if reading the stats
+// allocated in the last report.
+//
+// ./ns3 run "flow-stats-allocations --flows=10"
+
+#include "ns3/applications-module.h"
+
+#include "big-brother-tracker.cc"
+
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+NS_LOG_COMPONENT_DEFINE("FlowStatsAllocations");
+
+// Every operator new of the calling thread
+thread_local uint64_t ALLOCATIONS = 0;
+
+void* operator new(std::size_t size)
+{
+    ++ALLOCATIONS;
+    void* pointer = std::malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+const std::string FILENAME = "flow-stats-allocations";
+int EXIT_CODE = 0;
+// Reads the stats of the session as its reports do, set up after the first report
+ReportSession READS;
+
+// A report of the session, counting the allocations of the simulation thread
+bool countedReport(uint32_t classId, Time lastCalled)
+{
+    ReportSession& session = REPORT_SESSIONS.at(FILENAME);
+    Ptr<FlowMonitor> monitor = session.monitor;
+    size_t flows = monitor->GetFlowStats().size();
+
+    uint64_t before = ALLOCATIONS;
+    FlowMonitor::FlowStatsContainer copy = monitor->GetFlowStats();
+    uint64_t copying = ALLOCATIONS - before;
+
+    std::optional<uint64_t> reading;
+    if (READS.monitor) {
+        READS.report.duration = (Simulator::Now() - lastCalled).GetSeconds();
+        before = ALLOCATIONS;
+        snapshotFlowReport(READS, READS.report);
+        computeFlowKpis(monitor->GetHotCounters(), READS.report.duration, READS.meanDelays, READS.meanJitters);
+        reading = ALLOCATIONS - before;
+    }
+
+    before = ALLOCATIONS;
+    bool degraded = reportFlowStats(FILENAME, classId, lastCalled);
+    uint64_t reporting = ALLOCATIONS - before;
+
+    if (!READS.monitor) {
+        // The first report found the probes and the IPv6 classifier
+        READS.monitor = monitor;
+        READS.classifier = session.classifier;
+        READS.classifier6 = session.classifier6;
+        READS.rttProbes = session.rttProbes;
+        READS.nrProbes = session.nrProbes;
+        READS.detector = CreateObject<FlowAnomalyDetector>();
+    }
+
+    std::cout << "Report at " << Simulator::Now().As(Time::S) << ", " << flows << " flows: ";
+    if (reading.has_value()) {
+        std::cout << "reading the stats " << reading.value() << " allocations, ";
+    }
+    std::cout << "whole report " << reporting << " allocations (copying the stats: " << copying << ")" << std::endl;
+    // Only the last report counts: the earlier ones grow the buffers and learn the flows
+    EXIT_CODE = !reading.has_value() || reading.value() > 0 ? 1 : 0;
+    return degraded;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t flows = 10;
+    uint32_t analysisThreads = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("flows", "Number of UDP flows, besides the TCP transfer", flows);
+    cmd.AddValue("analysisThreads",
+                 "ANALYSIS_THREADS; with 0, the reports are written inline and their formatting is counted",
+                 analysisThreads);
+    cmd.Parse(argc, argv);
+
+    NodeContainer nodes;
+    nodes.Create(3);
+    InternetStackHelper internet;
+    internet.Install(nodes);
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    NetDeviceContainer d0d1 = p2p.Install(nodes.Get(0), nodes.Get(1));
+    NetDeviceContainer d1d2 = p2p.Install(nodes.Get(1), nodes.Get(2));
+
+    Ipv4AddressHelper ipv4;
+    ipv4.SetBase("10.1.1.0", "255.255.255.0");
+    ipv4.Assign(d0d1);
+    ipv4.SetBase("10.1.2.0", "255.255.255.0");
+    Ipv4InterfaceContainer i1i2 = ipv4.Assign(d1d2);
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+
+    ApplicationContainer apps;
+    for (uint16_t port = 9; port < 9 + flows; port++) {
+        OnOffHelper onoff("ns3::UdpSocketFactory", Address(InetSocketAddress(i1i2.GetAddress(1), port)));
+        onoff.SetConstantRate(DataRate("1Mbps"), 500);
+        apps.Add(onoff.Install(nodes.Get(0)));
+        PacketSinkHelper sink("ns3::UdpSocketFactory", Address(InetSocketAddress(Ipv4Address::GetAny(), port)));
+        apps.Add(sink.Install(nodes.Get(2)));
+    }
+    uint16_t tcpPort = 8080;
+    BulkSendHelper bulk("ns3::TcpSocketFactory", Address(InetSocketAddress(i1i2.GetAddress(1), tcpPort)));
+    bulk.SetAttribute("MaxBytes", UintegerValue(0));
+    apps.Add(bulk.Install(nodes.Get(0)));
+    PacketSinkHelper tcpSink("ns3::TcpSocketFactory", Address(InetSocketAddress(Ipv4Address::GetAny(), tcpPort)));
+    apps.Add(tcpSink.Install(nodes.Get(2)));
+    apps.Start(Seconds(0.1));
+    apps.Stop(Seconds(3));
+
+    FlowMonitorHelper flowmonHelper;
+    Ptr<FlowMonitor> monitor = flowmonHelper.InstallAll();
+    flowmonHelper.InstallRtt(nodes);
+    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
+
+    ANALYSIS_THREADS = analysisThreads;
+    Config::SetDefault("ns3::FlowAnomalyDetector::ZScoreLimit", DoubleValue(1e9));
+    Config::SetDefault("ns3::FlowAnomalyDetector::RelativeThroughputLimit", DoubleValue(1e9));
+    Config::SetDefault("ns3::FlowAnomalyDetector::RelativeDelayLimit", DoubleValue(1e9));
+    Config::SetDefault("ns3::FlowAnomalyDetector::RelativeJitterLimit", DoubleValue(1e9));
+    Ptr<MeasurementScheduler> scheduler = CreateObject<MeasurementScheduler>();
+    scheduler->SetAttribute("HealthyInterval", TimeValue(MilliSeconds(500)));
+    scheduler->SetAttribute("RelativeThroughputThreshold", DoubleValue(1e9));
+    scheduler->SetAttribute("RelativeDelayThreshold", DoubleValue(1e9));
+    scheduler->SetAttribute("RelativeJitterThreshold", DoubleValue(1e9));
+    scheduler->SetAttribute("StopTime", TimeValue(Seconds(3)));
+    // The session's own class would start after the stop: its reports come from countedReport
+    startFlowReports(scheduler, monitor, classifier, FILENAME, Seconds(3));
+    scheduler->AddClass(MakeCallback(&countedReport), Seconds(0));
+
+    Simulator::Stop(Seconds(2.75));
+    Simulator::Run();
+    Simulator::Destroy();
+    return EXIT_CODE;
+}
@@ -0,0 +1,140 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Measures the wall-clock cost of rebuilding the packet paths of a trigger
+// from the hops recorded by the probes: the radix-sorted columnar join of
+// joinFlowHops, against the former join that copied each packet's hop vector
+// out of a map, appended a node and assigned it back, then sorted every
+// packet's hops by delay.
+//
+// No simulation is run: the packets of every flow cross the same chain of
+// probed nodes, each adding its own delay.
+//
+// ./ns3 run "join-benchmark --probes=8 --flows=100 --packets=1000 --triggers=10"
+
+#include "big-brother-tracker.cc"
+
+#include <chrono>
+#include <iostream>
+
+NS_LOG_COMPONENT_DEFINE("JoinBenchmark");
+
+// Returns the seconds elapsed since start
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Delay from the first probe of a packet at a probe of the chain, in ns
+int64_t hopDelay(uint32_t probe, uint32_t packetId)
+{
+    return probe * 100000 + (packetId * 7919 + probe * 104729) % 5000;
+}
+
+// Joins a flow as nodeToNodeTrigger did before the columnar join: packetId -> (node, delay)
+// vectors copied, appended and assigned back for every probe and packet
+void mapCopyJoin(uint32_t probes, uint32_t packets, std::map<std::pair<uint32_t,uint32_t>,ns3::Time>& nodeToNodeDelay)
+{
+    std::map<uint32_t,std::vector<std::pair<uint32_t,ns3::Time>>> perPacketStats;
+    for (uint32_t probe = 0; probe < probes; probe++) {
+        for (uint32_t packetId = 0; packetId < packets; packetId++) {
+            std::vector<std::pair<uint32_t,ns3::Time>> nodeAcc;
+            auto perPacketStatsIt = perPacketStats.find(packetId);
+            if (perPacketStatsIt != perPacketStats.end()) {
+                nodeAcc = perPacketStatsIt->second;
+            }
+            nodeAcc.push_back(std::make_pair(probe, NanoSeconds(hopDelay(probe, packetId))));
+            perPacketStats.insert_or_assign(packetId, nodeAcc);
+        }
+    }
+    for (const auto& [packetId, hops] : perPacketStats) {
+        std::vector<std::pair<uint32_t,ns3::Time>> nodesDelay = hops;
+        std::sort(nodesDelay.begin(), nodesDelay.end(), [](const auto& a, const auto& b) {
+            return a.second < b.second;
+        });
+        for (size_t i = 0; i + 1 < nodesDelay.size(); ++i) {
+            std::pair<uint32_t,uint32_t> nodePair = std::minmax(nodesDelay[i].first, nodesDelay[i + 1].first);
+            nodeToNodeDelay.insert_or_assign(nodePair, nodesDelay[i + 1].second - nodesDelay[i].second);
+        }
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t probes = 8;
+    uint32_t flows = 100;
+    uint32_t packets = 1000;
+    uint32_t triggers = 10;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("probes", "Number of probed nodes crossed by every packet", probes);
+    cmd.AddValue("flows", "Number of flows", flows);
+    cmd.AddValue("packets", "Packets of every flow since the last trigger", packets);
+    cmd.AddValue("triggers", "Number of triggers timed", triggers);
+    cmd.Parse(argc, argv);
+
+    for (uint32_t probe = 0; probe + 1 < probes; probe++) {
+        addNodeAdjacency(probe, probe + 1);
+    }
+
+    // The rows of every flow as snapshotFlowHops copies them, probe after probe
+    std::vector<std::vector<PacketHop>> snapshot(flows);
+    for (std::vector<PacketHop>& hops : snapshot) {
+        for (uint32_t probe = 0; probe < probes; probe++) {
+            for (uint32_t packetId = 0; packetId < packets; packetId++) {
+                hops.push_back(PacketHop{packetId, probe, hopDelay(probe, packetId)});
+            }
+        }
+    }
+
+    double columnarTime = 0;
+    uint64_t columnarSamples = 0;
+    for (uint32_t t = 0; t < triggers; t++) {
+        std::vector<std::vector<PacketHop>> flowHops = snapshot;
+        UnattributedHops unattributed;
+        auto start = std::chrono::steady_clock::now();
+        LinkDelays linkDelays = joinFlowHops(flowHops, NODE_ADJACENCY, unattributed);
+        columnarTime += secondsSince(start);
+        columnarSamples = 0;
+        for (const auto& [link, delays] : linkDelays) {
+            columnarSamples += delays.samples;
+        }
+    }
+
+    double mapCopyTime = 0;
+    size_t mapCopyLinks = 0;
+    for (uint32_t t = 0; t < triggers; t++) {
+        std::map<std::pair<uint32_t,uint32_t>,ns3::Time> nodeToNodeDelay;
+        auto start = std::chrono::steady_clock::now();
+        for (uint32_t flow = 0; flow < flows; flow++) {
+            mapCopyJoin(probes, packets, nodeToNodeDelay);
+        }
+        mapCopyTime += secondsSince(start);
+        mapCopyLinks = nodeToNodeDelay.size();
+    }
+
+    uint64_t rows = uint64_t(flows) * packets * probes;
+    std::cout << "probes: " << probes << ", flows: " << flows << ", packets: " << packets
+              << ", triggers: " << triggers << " (" << rows << " hops per trigger)" << std::endl;
+    std::cout << "Columnar join: " << columnarTime * 1e3 / triggers << " ms/trigger, "
+              << columnarTime * 1e9 / triggers / rows << " ns/hop (" << columnarSamples << " link samples)" << std::endl;
+    std::cout << "Map-copy join: " << mapCopyTime * 1e3 / triggers << " ms/trigger, "
+              << mapCopyTime * 1e9 / triggers / rows << " ns/hop (" << mapCopyLinks << " links)" << std::endl;
+    std::cout << "Speedup:       " << mapCopyTime / columnarTime << "x" << std::endl;
+
+    return 0;
+}
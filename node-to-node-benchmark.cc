@@ -0,0 +1,136 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Measures the wall-clock cost of recording the node-to-node measurements of
+// nodeToNodeTrigger: the indexed series of NodeToNodeDoc, with and without
+// its append-only log, against the former walk of the <delay> elements of the
+// tinyxml2 document.  The final assembly of the XML document is timed too.
+//
+// No simulation is run: every trigger measures the same links.
+//
+// ./ns3 run "node-to-node-benchmark --links=500 --triggers=1000 --domTriggers=100"
+
+#include "big-brother-tracker.cc"
+
+#include <chrono>
+#include <iostream>
+
+NS_LOG_COMPONENT_DEFINE("NodeToNodeBenchmark");
+
+// Returns the seconds elapsed since start
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Records a trigger as nodeToNodeTrigger did before the index: every link
+// looks for its <delay> element among all of them, parsing the node ids
+void domRecordNodeToNodeDelays(XMLDocument& ntnXmlFile, XMLElement* delaysElement, const std::map<std::pair<uint32_t,uint32_t>,ns3::Time>& nodeToNodeDelay, int64_t timestamp)
+{
+    for (const auto& [nodePair, delay] : nodeToNodeDelay) {
+        XMLElement* delayElement = delaysElement->FirstChildElement("delay");
+        while (delayElement) {
+            XMLElement* nodePairElement = delayElement->FirstChildElement("node-pair");
+            uint32_t nodeId1 = std::stoul(nodePairElement->FirstChildElement("node-id")->GetText());
+            uint32_t nodeId2 = std::stoul(nodePairElement->LastChildElement("node-id")->GetText());
+            if (nodeId1 == nodePair.first && nodeId2 == nodePair.second) {
+                break;
+            }
+            delayElement = delayElement->NextSiblingElement("delay");
+        }
+        XMLElement* measurementsElement;
+        if (!delayElement) {
+            delayElement = ntnXmlFile.NewElement("delay");
+            delaysElement->InsertEndChild(delayElement);
+            insertNodePair(ntnXmlFile, delayElement, nodePair);
+            measurementsElement = ntnXmlFile.NewElement("measurements");
+            delayElement->InsertEndChild(measurementsElement);
+        } else {
+            measurementsElement = delayElement->FirstChildElement("measurements");
+        }
+        XMLElement* measurementElement = ntnXmlFile.NewElement("measurement");
+        insertDelayValue(ntnXmlFile, measurementElement, delay.GetNanoSeconds(), timestamp);
+        measurementsElement->InsertEndChild(measurementElement);
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t links = 500;
+    uint32_t triggers = 1000;
+    uint32_t domTriggers = 100;
+    std::string logPath = "node-to-node-benchmark.xml.log";
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("links", "Number of node pairs measured by every trigger", links);
+    cmd.AddValue("triggers", "Number of triggers recorded in the indexed document", triggers);
+    cmd.AddValue("domTriggers", "Number of triggers recorded by walking the XML document, 0 to skip", domTriggers);
+    cmd.AddValue("logPath", "Append-only log of the indexed document", logPath);
+    cmd.Parse(argc, argv);
+
+    // A chain of links, each with its own delay over a few packets
+    LinkDelays linkDelays;
+    std::map<std::pair<uint32_t,uint32_t>,ns3::Time> nodeToNodeDelay;
+    for (uint32_t i = 0; i < links; i++) {
+        for (uint32_t packet = 0; packet < 10; packet++) {
+            linkDelays[std::make_pair(i, i + 1)].add(100000 + 1000 * i + 100 * packet);
+        }
+        nodeToNodeDelay.emplace(std::make_pair(i, i + 1), NanoSeconds(std::llround(linkDelays[std::make_pair(i, i + 1)].mean)));
+    }
+
+    NodeToNodeDoc memoryDoc;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < triggers; t++) {
+        recordNodeToNodeDelays(memoryDoc, linkDelays, {}, t * 500000000LL);
+    }
+    double memoryTime = secondsSince(start);
+
+    NodeToNodeDoc loggedDoc;
+    loggedDoc.log.open(logPath.c_str(), std::ofstream::out | std::ofstream::trunc);
+    start = std::chrono::steady_clock::now();
+    for (uint32_t t = 0; t < triggers; t++) {
+        recordNodeToNodeDelays(loggedDoc, linkDelays, {}, t * 500000000LL);
+    }
+    double loggedTime = secondsSince(start);
+
+    NODE_TO_NODE_DOCS.emplace("node-to-node-benchmark.xml", std::move(memoryDoc));
+    start = std::chrono::steady_clock::now();
+    finalizeNodeToNodeDoc("node-to-node-benchmark.xml");
+    double finalizeTime = secondsSince(start);
+
+    std::cout << "links: " << links << ", triggers: " << triggers << std::endl;
+    std::cout << "Indexed record:       " << memoryTime * 1e6 / triggers << " us/trigger" << std::endl;
+    std::cout << "Indexed record + log: " << loggedTime * 1e6 / triggers << " us/trigger" << std::endl;
+    std::cout << "Finalize:             " << finalizeTime * 1e3 << " ms" << std::endl;
+
+    if (domTriggers > 0) {
+        XMLDocument ntnXmlFile;
+        XMLElement* root = ntnXmlFile.NewElement("network-measurements");
+        ntnXmlFile.InsertEndChild(root);
+        XMLElement* delaysElement = ntnXmlFile.NewElement("delays");
+        root->InsertEndChild(delaysElement);
+        start = std::chrono::steady_clock::now();
+        for (uint32_t t = 0; t < domTriggers; t++) {
+            domRecordNodeToNodeDelays(ntnXmlFile, delaysElement, nodeToNodeDelay, t * 500000000LL);
+        }
+        double domTime = secondsSince(start);
+        std::cout << "DOM walk record:      " << domTime * 1e6 / domTriggers << " us/trigger ("
+                  << domTriggers << " triggers, without the file load and save)" << std::endl;
+    }
+
+    return 0;
+}
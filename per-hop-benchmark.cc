@@ -0,0 +1,107 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Measures the wall-clock cost of a packet's hop at a big-brother probe for
+// several BigBrotherProbeImpl instantiations: the full probe (FlowProbe stats,
+// per-hop records and drops, as the original BigBrotherFlowProbe), the lean
+// per-hop probe, the per-hop probe sampling a tenth of the packets, and the
+// probe that only keeps the FlowProbe stats.
+//
+// No simulation is run: the hops are fed straight into AddPacketStats, and the
+// per-hop records are cleared every window as ResetAllStats does.
+//
+// ./ns3 run "per-hop-benchmark --flows=100 --packets=1000 --windows=20"
+
+#include "ns3/big-brother-flow-probe.h"
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("PerHopBenchmark");
+
+// Returns the seconds elapsed since start
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Feeds windows * flows * packets hops into the probe, returns the ns per hop
+double timeHops(Ptr<BigBrotherFlowProbe> probe, uint32_t flows, uint32_t packets, uint32_t windows)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t w = 0; w < windows; w++) {
+        for (uint32_t p = 0; p < packets; p++) {
+            FlowPacketId packetId = w * packets + p;
+            for (FlowId flowId = 1; flowId <= flows; flowId++) {
+                probe->AddPacketStats(flowId, packetId, 1400, MicroSeconds(100 + p % 50));
+            }
+        }
+        probe->ClearPerPacketStats();
+    }
+    return secondsSince(start) * 1e9 / (double(windows) * flows * packets);
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t flows = 100;
+    uint32_t packets = 1000;
+    uint32_t windows = 20;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("flows", "Number of flows crossing the probe", flows);
+    cmd.AddValue("packets", "Packets of every flow per window", packets);
+    cmd.AddValue("windows", "Number of measurement windows", windows);
+    cmd.Parse(argc, argv);
+
+    NodeContainer nodes;
+    nodes.Create(1);
+    InternetStackHelper internet;
+    internet.Install(nodes);
+
+    Ptr<FlowMonitor> monitor = CreateObject<FlowMonitor>();
+    Ptr<Ipv4FlowClassifier> classifier = Create<Ipv4FlowClassifier>();
+    monitor->AddFlowClassifier(classifier);
+
+    using namespace bigbrother;
+    const std::pair<const char*, uint32_t> variants[] = {
+        {"full (stats, per-hop, drops)", DEFAULT_FEATURES},
+        {"lean (per-hop)", PerHop::mask},
+        {"lean, 10% sampled", PerHop::mask | Sampling::mask},
+        {"stats only", ProbeFlowStats::mask},
+    };
+
+    std::cout << "flows: " << flows << ", packets: " << packets << ", windows: " << windows << std::endl;
+    double fullTime = 0;
+    for (const auto& [name, features] : variants) {
+        Ptr<BigBrotherFlowProbe> probe = CreateBigBrotherFlowProbe(features, monitor, classifier, nodes.Get(0));
+        probe->SetSamplingRate(features & Sampling::mask ? 0.1 : 1.0);
+        double hopTime = timeHops(probe, flows, packets, windows);
+        if (fullTime == 0) {
+            fullTime = hopTime;
+        }
+        std::cout << name << ": " << hopTime << " ns/hop (" << hopTime / fullTime << " of full)" << std::endl;
+    }
+
+    Simulator::Destroy();
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+// Checks that the node-to-node join reports the links between the probed nodes
+// of topology_1_3, whose probes skip the gNBs and the SGW: the UEs, the pgw, the
+// two intermediate nodes and the remoteHost. The UE <-> pgw links go through a
+// gNB and the SGW, and must be reported as single links instead of unattributed
+// sightings.
+//
+// UEs --- gNBs --- SGW --- pgw --- in_1 --- in_2 --- remoteHost, the UEs attached
+// with addNodeAdjacency() as in topology_1_3. No simulation is run: the hops of
+// a downlink and an uplink flow per UE are fed straight into joinFlowHops.
+// Exits with 1 if a UE <-> pgw link is missing.
+//
+// ./ns3 run "probed-adjacency-check --gnbs=2 --uesPerGnb=3"
+
+#include "big-brother-tracker.cc"
+
+#include <iostream>
+
+NS_LOG_COMPONENT_DEFINE("ProbedAdjacencyCheck");
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t gnbs = 2;
+    uint32_t uesPerGnb = 3;
+    uint32_t packets = 100;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("gnbs", "Number of gNBs", gnbs);
+    cmd.AddValue("uesPerGnb", "Number of UEs attached to every gNB", uesPerGnb);
+    cmd.AddValue("packets", "Packets of every flow", packets);
+    cmd.Parse(argc, argv);
+
+    NodeContainer gnbNodes;
+    gnbNodes.Create(gnbs);
+    NodeContainer ueNodes;
+    ueNodes.Create(gnbs * uesPerGnb);
+    Ptr<Node> sgw = CreateObject<Node>();
+    Ptr<Node> pgw = CreateObject<Node>();
+    NodeContainer intermediateNodes;
+    intermediateNodes.Create(2);
+    Ptr<Node> remoteHost = CreateObject<Node>();
+    InternetStackHelper internet;
+    internet.Install(NodeContainer::GetGlobal());
+
+    PointToPointHelper p2p;
+    for (uint32_t g = 0; g < gnbs; g++) {
+        p2p.Install(gnbNodes.Get(g), sgw);
+    }
+    p2p.Install(sgw, pgw);
+    p2p.Install(pgw, intermediateNodes.Get(0));
+    p2p.Install(intermediateNodes.Get(0), intermediateNodes.Get(1));
+    p2p.Install(intermediateNodes.Get(1), remoteHost);
+    for (uint32_t u = 0; u < ueNodes.GetN(); u++) {
+        // The radio link has no ns-3 channel between the two nodes
+        addNodeAdjacency(ueNodes.Get(u)->GetId(), gnbNodes.Get(u / uesPerGnb)->GetId());
+    }
+
+    // The probes of topology_1_3, without radioProbes
+    NodeContainer endpointNodes;
+    endpointNodes.Add(remoteHost);
+    endpointNodes.Add(ueNodes);
+    endpointNodes.Add(intermediateNodes);
+    endpointNodes.Add(pgw);
+    FlowMonitorHelper flowmonHelper;
+    Ptr<FlowMonitor> monitor = flowmonHelper.Install(endpointNodes);
+
+    // A downlink and an uplink flow per UE, as the probes record them: the delay from
+    // the first probe, 1ms per wired link and 5ms over the radio link and the EPC
+    std::vector<uint32_t> downlinkPath = {remoteHost->GetId(), intermediateNodes.Get(1)->GetId(),
+                                          intermediateNodes.Get(0)->GetId(), pgw->GetId()};
+    std::vector<std::vector<PacketHop>> flows;
+    for (uint32_t u = 0; u < ueNodes.GetN(); u++) {
+        std::vector<uint32_t> path = downlinkPath;
+        path.push_back(ueNodes.Get(u)->GetId());
+        for (bool downlink : {true, false}) {
+            std::vector<PacketHop>& hops = flows.emplace_back();
+            for (uint32_t packetId = 0; packetId < packets; packetId++) {
+                int64_t delay = 0;
+                for (size_t i = 0; i < path.size(); i++) {
+                    uint32_t nodeId = downlink ? path[i] : path[path.size() - 1 - i];
+                    hops.push_back(PacketHop{packetId, nodeId, delay});
+                    bool radioHop = downlink ? i + 2 == path.size() : i == 0;
+                    delay += radioHop ? 5000000 : 1000000 + packetId % 10 * 1000;
+                }
+            }
+        }
+    }
+
+    const NodeAdjacency& adjacency = getProbedAdjacency(monitor);
+    std::vector<std::vector<PacketHop>> channelFlows = flows;
+    UnattributedHops unattributed;
+    LinkDelays linkDelays = joinFlowHops(flows, adjacency, unattributed);
+    UnattributedHops channelUnattributed;
+    joinFlowHops(channelFlows, NODE_ADJACENCY, channelUnattributed);
+
+    uint32_t ueLinks = 0;
+    for (const auto& [nodePair, delay] : linkDelays) {
+        std::cout << "(" << nodePair.first << "," << nodePair.second << "): " << delay.mean / 1e6 << " ms, "
+                  << delay.samples << " samples" << std::endl;
+    }
+    for (uint32_t u = 0; u < ueNodes.GetN(); u++) {
+        uint32_t ue = ueNodes.Get(u)->GetId();
+        ueLinks += linkDelays.count({ue, pgw->GetId()}) + linkDelays.count({pgw->GetId(), ue});
+    }
+    std::cout << "UE <-> pgw links: " << ueLinks << " of " << 2 * ueNodes.GetN() << ", "
+              << unattributed.size() << " unattributed node pairs" << std::endl;
+    std::cout << "Joined on the channels only: " << channelUnattributed.size() << " unattributed node pairs" << std::endl;
+
+    Simulator::Destroy();
+    return ueLinks == 2 * ueNodes.GetN() && unattributed.empty() ? 0 : 1;
+}
@@ -32,6 +32,7 @@
 #include "ns3/gnuplot-helper.h"
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/flow-monitor.h"
+#include "ns3/ipv4-aggregate-flow-classifier.h"
 #include <fstream> 
 #include "big-brother-tracker.cc"
 #include <tinyxml2.h>
@@ -715,6 +716,11 @@ main(int argc, char* argv[])
     bool logging = false;
     bool traces = true;
     bool useUdp = true;
+    bool leanProbes = false;
+    bool radioProbes = false;
+    bool rttProbes = false;
+    std::string aggregateFlows = "";
+    uint32_t flowEvictionTimeoutMs = 0;
 
     uint8_t ngmnMixedFtpPercentage = 10;
     uint8_t ngmnMixedHttpPercentage = 20;
@@ -723,6 +729,7 @@ main(int argc, char* argv[])
     uint8_t ngmnMixedGamingPercentage = 20;
 
     std::string bottleNeckDelay =  "100ns";
+    std::string baselineDir = "./contrib/nr/examples/experiments/initial_states/avgs";
 
     /*
      * From here, we instruct the ns3::CommandLine class of all the input parameters
@@ -759,6 +766,44 @@ main(int argc, char* argv[])
                  simTag);
     cmd.AddValue("outputDir", "directory where to store simulation results", outputDir);
     cmd.AddValue("bottleNeckDelay", "delay to insert in the bottle neck", bottleNeckDelay);
+    cmd.AddValue("leanProbes",
+                 "if true, the big-brother probes only record per-hop data, skipping the "
+                 "per-probe flow stats and drop tracking",
+                 leanProbes);
+    cmd.AddValue("radioProbes",
+                 "if true, split the radio delay of every packet into RLC buffer wait and "
+                 "air delay, logged per flow by the reports. Use with --traces=false to avoid "
+                 "the nr text traces",
+                 radioProbes);
+    cmd.AddValue("rttProbes",
+                 "if true, pair the directions of each TCP connection and log their passive "
+                 "RTT in the flow performance measurements (useful with useUdp=0)",
+                 rttProbes);
+    cmd.AddValue("aggregateFlows",
+                 "if not empty, flows are aggregated instead of being keyed on the five-tuple. "
+                 "Comma-separated dimensions among: ue, prefix (destination /24), cell, dscp",
+                 aggregateFlows);
+    cmd.AddValue("flowEvictionTimeoutMs",
+                 "if not zero, flows idle for this long are appended to <simTag>..._flows.csv "
+                 "and removed from the flow monitor, so reports only iterate the active flows",
+                 flowEvictionTimeoutMs);
+    cmd.AddValue("analysisThreads",
+                 "if not zero, the node-to-node triggers are analysed by this many background "
+                 "threads while the simulation goes on, and logged by the next report",
+                 ANALYSIS_THREADS);
+    cmd.AddValue("statsFormat",
+                 "format of the rows of <simTag>..._stats.dat: tsv, csv, or long (self-describing "
+                 "records, with the five-tuples of the flows)",
+                 STATS_FORMAT);
+    cmd.AddValue("baselineDir",
+                 "directory of the _stats.dat_avg.csv baselines of a previous campaign; the one "
+                 "of this configuration is the baseline of the reports, empty to take it from "
+                 "the first report",
+                 baselineDir);
+    cmd.AddValue("reportFlushInterval",
+                 "simulation time between two writes of the buffered report files, "
+                 "0 to write them at every report",
+                 REPORT_FLUSH_INTERVAL);
 
     // Parse the command line
     cmd.Parse(argc, argv);
@@ -1086,6 +1131,7 @@ main(int argc, char* argv[])
     }
 
     // attach UEs to their gNB. Try to attach them per cellId order
+    std::vector<std::pair<Ipv4Address, uint16_t>> ueCells; // for the aggregate classifier
     for (uint32_t u = 0; u < ueNum; ++u)
     {
         uint32_t sector = u % ffr;
@@ -1094,8 +1140,12 @@ main(int argc, char* argv[])
         {
             Ptr<NetDevice> gnbNetDev = gnbSector1NetDev.Get(i % gridScenario.GetNumSites());
             Ptr<NetDevice> ueNetDev = ueSector1NetDev.Get(i);
+            ueCells.emplace_back(ueSector1IpIface.GetAddress(i, 0),
+                                 DynamicCast<NrGnbNetDevice>(gnbNetDev)->GetCellId());
 
             nrHelper->AttachToEnb(ueNetDev, gnbNetDev);
+            // The radio link has no ns-3 channel between the two nodes
+            addNodeAdjacency(ueNetDev->GetNode()->GetId(), gnbNetDev->GetNode()->GetId());
 
             if (logging == true)
             {
@@ -1109,7 +1159,10 @@ main(int argc, char* argv[])
         {
             Ptr<NetDevice> gnbNetDev = gnbSector2NetDev.Get(i % gridScenario.GetNumSites());
             Ptr<NetDevice> ueNetDev = ueSector2NetDev.Get(i);
+            ueCells.emplace_back(ueSector2IpIface.GetAddress(i, 0),
+                                 DynamicCast<NrGnbNetDevice>(gnbNetDev)->GetCellId());
             nrHelper->AttachToEnb(ueNetDev, gnbNetDev);
+            addNodeAdjacency(ueNetDev->GetNode()->GetId(), gnbNetDev->GetNode()->GetId());
             if (logging == true)
             {
                 Vector gnbpos = gnbNetDev->GetNode()->GetObject<MobilityModel>()->GetPosition();
@@ -1122,7 +1175,10 @@ main(int argc, char* argv[])
         {
             Ptr<NetDevice> gnbNetDev = gnbSector3NetDev.Get(i % gridScenario.GetNumSites());
             Ptr<NetDevice> ueNetDev = ueSector3NetDev.Get(i);
+            ueCells.emplace_back(ueSector3IpIface.GetAddress(i, 0),
+                                 DynamicCast<NrGnbNetDevice>(gnbNetDev)->GetCellId());
             nrHelper->AttachToEnb(ueNetDev, gnbNetDev);
+            addNodeAdjacency(ueNetDev->GetNode()->GetId(), gnbNetDev->GetNode()->GetId());
             if (logging == true)
             {
                 Vector gnbpos = gnbNetDev->GetNode()->GetObject<MobilityModel>()->GetPosition();
@@ -1920,6 +1976,47 @@ main(int argc, char* argv[])
     }
 
     FlowMonitorHelper flowmonHelper;
+    if (leanProbes)
+    {
+        flowmonHelper.SetProbeAttribute("ProbeFlowStats", BooleanValue(false));
+        flowmonHelper.SetProbeAttribute("DropTracking", BooleanValue(false));
+    }
+    if (!aggregateFlows.empty())
+    {
+        uint32_t dimensions = 0;
+        std::istringstream names(aggregateFlows);
+        std::string name;
+        while (std::getline(names, name, ','))
+        {
+            if (name == "ue")
+            {
+                dimensions |= Ipv4AggregateFlowClassifier::UE;
+            }
+            else if (name == "prefix")
+            {
+                dimensions |= Ipv4AggregateFlowClassifier::DESTINATION_PREFIX;
+            }
+            else if (name == "cell")
+            {
+                dimensions |= Ipv4AggregateFlowClassifier::CELL;
+            }
+            else if (name == "dscp")
+            {
+                dimensions |= Ipv4AggregateFlowClassifier::DSCP;
+            }
+            else
+            {
+                NS_ABORT_MSG("Unknown aggregateFlows dimension " << name);
+            }
+        }
+        Ptr<Ipv4AggregateFlowClassifier> aggregateClassifier =
+            Create<Ipv4AggregateFlowClassifier>(dimensions);
+        for (const auto& [ue, cellId] : ueCells)
+        {
+            aggregateClassifier->SetCell(ue, cellId);
+        }
+        flowmonHelper.SetClassifier(aggregateClassifier);
+    }
     NodeContainer endpointNodes;
     endpointNodes.Add(remoteHost);
     endpointNodes.Add(gridScenario.GetUserTerminals());
@@ -1927,17 +2024,54 @@ main(int argc, char* argv[])
     endpointNodes.Add(pgw);
 
     Ptr<ns3::FlowMonitor> flowMonitor = flowmonHelper.Install(endpointNodes);
+    if (radioProbes)
+    {
+        NodeContainer radioNodes;
+        radioNodes.Add(gridScenario.GetBaseStations());
+        radioNodes.Add(gridScenario.GetUserTerminals());
+        flowmonHelper.InstallNr(radioNodes);
+    }
+    if (rttProbes)
+    {
+        NodeContainer rttNodes;
+        rttNodes.Add(remoteHost);
+        rttNodes.Add(gridScenario.GetUserTerminals());
+        flowmonHelper.InstallRtt(rttNodes);
+    }
     flowMonitor->SetAttribute("DelayBinWidth", DoubleValue(0.001));
     flowMonitor->SetAttribute("JitterBinWidth", DoubleValue(0.001));
     flowMonitor->SetAttribute("PacketSizeBinWidth", DoubleValue(20));
     std::ostringstream oss;
     oss << outputDir << "/" << simTag << "_simTime-" << simTimeMs << "_trafficTypeConf-" << trafficTypeConf << "_direction-" << direction << "_bottleNeckDelay-" << bottleNeckDelay << "_useUdp-" << useUdp << "_uesPerGnb-" << uesPerGnb;
      std::string filename = oss.str();
+    if (flowEvictionTimeoutMs > 0)
+    {
+        flowMonitor->SetAttribute("FlowArchiveFile", StringValue(filename + "_flows.csv"));
+        flowMonitor->SetAttribute("FlowEvictionTimeout",
+                                  TimeValue(MilliSeconds(flowEvictionTimeoutMs)));
+    }
     flowMonitor->CheckForLostPackets();
     Ptr<Ipv4FlowClassifier> classifier =
         DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier());
-    Simulator::Schedule(MilliSeconds(1400),&reportFlowStats,flowMonitor,classifier,filename,MilliSeconds(400),simTime,TrackedStats());
-    // Simulator::Schedule(MilliSeconds(2400),&reportFlowStats,flowMonitor,classifier,filename, false);
+    // Reports every second while the flows are healthy, faster while they are degraded.
+    // The cadence is set with --ns3::MeasurementScheduler::<attribute>=<value>
+    Ptr<MeasurementScheduler> measurementScheduler = CreateObject<MeasurementScheduler>();
+    measurementScheduler->SetAttribute("StopTime", TimeValue(simTime));
+    // With the baseline of this configuration from a previous campaign, the degradations are
+    // detected from the first report, and a degraded warm-up can't skew the baseline
+    const ScenarioBaseline* baseline = nullptr;
+    if (!baselineDir.empty() && loadBaselineStore(baselineDir) > 0)
+    {
+        std::ostringstream trafficTypeName;
+        trafficTypeName << trafficTypeConf;
+        baseline = findBaseline(trafficTypeName.str(), direction, useUdp, uesPerGnb);
+    }
+    if (!baseline)
+    {
+        std::cout << "No baseline for this configuration in " << baselineDir
+                  << ", the first report takes it" << std::endl;
+    }
+    startFlowReports(measurementScheduler, flowMonitor, classifier, filename, MilliSeconds(400), baseline);
     // Simulator::Stop(simTime);
 
     Simulator::Run();